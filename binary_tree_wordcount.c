@@ -7,6 +7,111 @@
  * the occurrences of words in input. Each node contains a word, a count,
  * and pointers to left and right children. The tree is printed in order.
  *
+ * Keeping the tree balanced:
+ *   A plain BST has the shape of its input. Sorted input (a dictionary, the output of
+ *   sort) makes every new word the right child of the last one: the "tree" is a linked
+ *   list, each insert walks all of it, and the recursive tree()/treeprint()/treefree()
+ *   recurse once per word, which overflows the stack for big inputs.
+ *   This version is an AVL tree: every node stores the height of its subtree, and after
+ *   an insert any node whose two sides differ in height by more than one is fixed with
+ *   a rotation. The height stays below 1.44 * log2(n), about 34 for 10 million words.
+ *   All three operations are loops; the deepest stack they need is MAX_HEIGHT pointers.
+ *
+ * Reading the input:
+ *   getword() fetches one character at a time with getchar()/ungetc() and copies each
+ *   word into a buffer. On gigabytes of text those per-byte calls cost more than the
+ *   counting. Here files are mmap()ed (stdin is read in 16 MB blocks), and words are
+ *   found 64 bytes at a time:
+ *     - SSE2 classifies 16 bytes per instruction as letter/digit or not, and four of
+ *       those make a 64-bit mask with one bit per byte.
+ *     - Shifting the mask by one and comparing finds where every run of letters and
+ *       digits starts and ends; the loop then jumps from one boundary to the next.
+ *     - A word is handed on as pointer + length into the input, never copied. Only a
+ *       new tree node copies it (lowercased).
+ *   Words are what getword() returns: a letter followed by letters and digits, with
+ *   case ignored. Digits in front of a word are not part of it ("3rd" counts "rd").
+ *
+ * Counting with threads (-j N):
+ *   The input is cut into chunks that end between words. Each thread counts its chunks
+ *   into its own private tree, with no locking, then flattens the tree into a sorted
+ *   array. The N sorted arrays are merged in parallel as well: sampled words split
+ *   the alphabet into N ranges, and each thread k-way merges one range of every array
+ *   (a heap of N cursors), adding up the counts of equal words and formatting its part
+ *   of the output. The parts are written in range order, so the output is the same as
+ *   treeprint() on a single tree. The step-by-step trace is off with -j.
+ *
+ * Most frequent words first:
+ *   --sort-count copies (count, word) records into a flat array and sorts that, instead
+ *   of walking node pointers. --top K prints only the K most frequent words: a min-heap
+ *   of K nodes is kept up to date while counting (counts only grow, so a word can only
+ *   enter the top K by passing its current lowest member). Printing it then costs
+ *   O(K log K), whatever the number of distinct words. With -j, each merge thread keeps
+ *   a K-entry heap over its range instead, and the heaps are combined at the end.
+ *   Ties are broken alphabetically.
+ *
+ * An adaptive radix tree index (--art):
+ *   Each level of the AVL tree is a strcmp() and a pointer to a node somewhere else in
+ *   memory, and each word costs a 40-byte node plus a strdup(). A radix tree branches on
+ *   one byte of the word per level instead, and its nodes adapt to how many children
+ *   they have: Node4 and Node16 (sorted bytes, the latter searched with one SSE2 compare),
+ *   Node48 (a 256-byte index into 48 slots) and Node256 (a direct array). Bytes that
+ *   all keys below a node share are stored once in the node (path compression), and a
+ *   word's leaf, its count plus the only copy of the word, hangs as high as the word is
+ *   unique. Children are kept in byte order, so an in-order walk prints exactly what
+ *   treeprint() prints. Only counting is different: the trace and -j use the AVL tree.
+ *
+ * Keeping counts between runs (--store STORE):
+ *   treefree() forgets everything, so adding one day of logs used to mean recounting
+ *   all of them. --store merges this run's counts into a file instead. The file holds
+ *   the words in order, each stored as the number of bytes it shares with the previous
+ *   word plus the rest, with varint lengths and counts. The new counts come out of the
+ *   tree in order too, so a single streaming pass merges the two into a new file, which
+ *   then replaces the old one: the work is the old file plus the new input. The old file
+ *   is read through mmap(). --show prints a store.
+ *
+ * Approximate counting in fixed memory (--approx BYTES):
+ *   The tree needs a node and a copy of every distinct word, so an endless stream of new
+ *   words (log files) eventually fills memory. --approx keeps three fixed-size sketches:
+ *     - A Count-Min sketch: 4 rows of counters, each word hashed to one counter per row.
+ *       A word's estimate is its smallest counter, which can only be too high, by at
+ *       most e/width * total words with probability 1 - e^-4 (98%). A conservative
+ *       update only raises the counters at that minimum, which cuts the error further.
+ *     - Heavy hitters: a min-heap of the K words with the highest estimates so far.
+ *     - HyperLogLog: the highest "rank" (leading zero bits + 1) of word hashes in each
+ *       of m buckets estimates the number of distinct words, within 1.04/sqrt(m).
+ *   --save writes the sketch to a file; --merge adds sketch files built with the same
+ *   budget together, so per-shard runs combine into one result.
+ *
+ * Usage:
+ *   ./binary_tree_wordcount [FILE...]    count words in FILEs (or stdin), tracing every step
+ *   ./binary_tree_wordcount -q [FILE...] the same, printing only the word counts
+ *   ./binary_tree_wordcount -j N [FILE...]  count with N threads (implies -q)
+ *   ./binary_tree_wordcount --top K [FILE...]  only the K most frequent words
+ *   ./binary_tree_wordcount --sort-count [FILE...]  all words, most frequent first
+ *   ./binary_tree_wordcount --art [FILE...]  count in an adaptive radix tree (no trace)
+ *   ./binary_tree_wordcount --store STORE [FILE...]  add the counts to the file STORE
+ *   ./binary_tree_wordcount --show STORE  print a store (with --top K or --sort-count too)
+ *   ./binary_tree_wordcount --approx BYTES [--top K] [--save SKETCH] [FILE...]
+ *                                        approximate counts in a fixed memory budget
+ *                                        (like 64M): the K (default 20) most frequent
+ *                                        words, the number of distinct words, error bounds
+ *   ./binary_tree_wordcount --merge [--save SKETCH] SKETCH...  combine saved sketches
+ *   ./binary_tree_wordcount --bench [N]  N sorted, reverse-sorted and natural-text words
+ *                                        (default 10M)
+ *   ./binary_tree_wordcount --bench-tokens [MB]  getword() vs the block tokenizer on
+ *                                        MB megabytes of text (default 256)
+ *   ./binary_tree_wordcount --bench-threads [MB] [T]  -j 1, 2, 4, ... T (default 64) on
+ *                                        MB megabytes of text (default 1024)
+ *   ./binary_tree_wordcount --bench-output [N]  output time for N distinct words (default 10M):
+ *                                        alphabetical, --sort-count and --top 100
+ *   ./binary_tree_wordcount --bench-store [DAYS] [MB]  recounting all days vs --store, for
+ *                                        DAYS (default 10) days of MB (default 32) MB each
+ *   ./binary_tree_wordcount --bench-index [N]  AVL tree vs --art on N natural-text words and
+ *                                        N URL-like keys (default 10M)
+ *   ./binary_tree_wordcount --bench-sketch [MB] [BYTES]  --approx errors against exact
+ *                                        counts on MB megabytes of text (default 128,
+ *                                        budgets of 1/4, 1 and 4 times BYTES, default 1M)
+ *
  * Author: Andrew M.
  * Date: July 2025
  */
@@ -15,73 +120,403 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define MAXWORD 100
+#define MAX_HEIGHT 64        // an AVL tree this tall would hold more than 2^44 words
+#define READ_BLOCK (16 * 1024 * 1024)  // bytes per read() when the input is stdin
+#define MAX_THREADS 256
+#define SAMPLES_PER_RANGE 16     // sampled words per merge range, to pick the splitters
 
 // Tree node structure
 struct tnode {
     char *word;
     int count;
+    int height;              // levels in the subtree rooted here (a leaf is 1)
+    int heap_pos;            // index in top_heap (--top), or -1
     struct tnode *left;
     struct tnode *right;
 };
 
 typedef struct tnode TNode;
 
-// Create a new tree node, with debug print
-TNode *talloc(const char *w) {
+static int trace = 1;        // print a line for every step (off with -q)
+static int use_art;          // --art: count in an adaptive radix tree instead
+static int order_count;      // --sort-count: print by count, most frequent first
+static size_t top_k;         // --top K: print only the K most frequent words
+static TNode **top_heap;     // --top: the K highest-ranked nodes, lowest-ranked at [0]
+static size_t top_n;
+
+static void top_update(TNode *p);
+
+// Create a new tree node for the len-byte word w (stored lowercased), with debug print
+TNode *talloc(const char *w, size_t len) {
     TNode *node = (TNode *)malloc(sizeof(TNode));
-    if (!node) {
-        fprintf(stderr, "[Error] Memory allocation failed for node with word '%s'\n", w);
+    char *word = (char *)malloc(len + 1);
+    if (!node || !word) {
+        fprintf(stderr, "[Error] Memory allocation failed for node with word '%.*s'\n", (int)len, w);
+        free(node);
+        free(word);
         return NULL;
     }
-    node->word = strdup(w);
+    for (size_t i = 0; i < len; ++i)
+        word[i] = w[i] | 0x20;   // lowercase: letters only (digits already have 0x20 set)
+    word[len] = '\0';
+    node->word = word;
     node->count = 1;
+    node->height = 1;
+    node->heap_pos = -1;
     node->left = node->right = NULL;
-    printf("[Alloc] New node at %p for word '%s'\n", (void*)node, w);
+    if (trace) printf("[Alloc] New node at %p for word '%s'\n", (void*)node, word);
     return node;
 }
 
-// Insert or update a word in the tree, with debug prints
-TNode *tree(TNode *p, const char *w) {
-    int cond;
-    if (p == NULL) {
-        printf("[Insert] '%s' (new leaf)\n", w);
-        return talloc(w);
-    } else if ((cond = strcmp(w, p->word)) == 0) {
-        p->count++;
-        printf("[Update] '%s' already exists at %p, increment count to %d\n", w, (void*)p, p->count);
-    } else if (cond < 0) {
-        printf("[Traverse] '%s' < '%s', go left from %p\n", w, p->word, (void*)p);
-        p->left = tree(p->left, w);
-    } else {
-        printf("[Traverse] '%s' > '%s', go right from %p\n", w, p->word, (void*)p);
-        p->right = tree(p->right, w);
+// strcmp() of the lowercased slice w[0..len) against a stored word
+static int wordcmp(const char *w, size_t len, const char *word) {
+    for (size_t i = 0; i < len; ++i) {
+        int a = (unsigned char)(w[i] | 0x20), b = (unsigned char)word[i];
+        if (a != b) return a - b;    // also right when word ends first (b == 0)
+    }
+    return word[len] ? -1 : 0;
+}
+
+static int height(const TNode *p) {
+    return p ? p->height : 0;
+}
+
+static void fix_height(TNode *p) {
+    int hl = height(p->left), hr = height(p->right);
+    p->height = 1 + (hl > hr ? hl : hr);
+}
+
+// p's left child becomes the root of this subtree; p becomes its right child
+static TNode *rotate_right(TNode *p) {
+    TNode *q = p->left;
+    if (trace) printf("[Rotate] right at '%s', '%s' moves up\n", p->word, q->word);
+    p->left = q->right;
+    q->right = p;
+    fix_height(p);
+    fix_height(q);
+    return q;
+}
+
+static TNode *rotate_left(TNode *p) {
+    TNode *q = p->right;
+    if (trace) printf("[Rotate] left at '%s', '%s' moves up\n", p->word, q->word);
+    p->right = q->left;
+    q->left = p;
+    fix_height(p);
+    fix_height(q);
+    return q;
+}
+
+// Restores the AVL rule at p (sides differ in height by at most one); returns the new subtree root
+static TNode *rebalance(TNode *p) {
+    fix_height(p);
+    int balance = height(p->left) - height(p->right);
+    if (balance > 1) {
+        if (height(p->left->left) < height(p->left->right))
+            p->left = rotate_left(p->left);      // left-right case: make it left-left first
+        return rotate_right(p);
+    }
+    if (balance < -1) {
+        if (height(p->right->right) < height(p->right->left))
+            p->right = rotate_right(p->right);   // right-left case
+        return rotate_left(p);
     }
     return p;
 }
 
+// Insert the word w[0..len) (letters and digits, any case) or add n to its count,
+// with debug prints. Returns the (possibly new) root.
+TNode *tree_add(TNode *root, const char *w, size_t len, int n) {
+    TNode **path[MAX_HEIGHT];    // links followed from the root, to rebalance on the way back
+    int depth = 0, cond;
+    TNode **link = &root;
+    while (*link) {
+        TNode *p = *link;
+        if ((cond = wordcmp(w, len, p->word)) == 0) {
+            p->count += n;
+            if (trace) printf("[Update] '%s' already exists at %p, increment count to %d\n", p->word, (void*)p, p->count);
+            if (top_heap) top_update(p);
+            return root;
+        }
+        if (trace) printf("[Traverse] '%.*s' %c '%s', go %s from %p\n", (int)len, w, cond < 0 ? '<' : '>',
+                          p->word, cond < 0 ? "left" : "right", (void*)p);
+        path[depth++] = link;
+        link = cond < 0 ? &p->left : &p->right;
+    }
+    if (trace) printf("[Insert] '%.*s' (new leaf)\n", (int)len, w);
+    if ((*link = talloc(w, len)) == NULL)
+        return root;
+    (*link)->count = n;
+    if (top_heap) top_update(*link);
+    // Walk back up. Once a subtree's height is what it was before the insert
+    // (after a rotation it always is), nothing above it can be out of balance.
+    while (depth > 0) {
+        TNode **l = path[--depth];
+        int before = (*l)->height;
+        *l = rebalance(*l);
+        if ((*l)->height == before)
+            break;
+    }
+    return root;
+}
+
+// Insert or update the word w[0..len), counting it once
+TNode *tree_n(TNode *root, const char *w, size_t len) {
+    return tree_add(root, w, len, 1);
+}
+
+// Insert or update a word given as a C string
+TNode *tree(TNode *root, const char *w) {
+    return tree_n(root, w, strlen(w));
+}
+
+// Print the tree in-order to out, using an explicit stack instead of recursion
+void treeprint_to(const TNode *p, FILE *out) {
+    const TNode *stack[MAX_HEIGHT];
+    int sp = 0;
+    while (p != NULL || sp > 0) {
+        while (p != NULL) {
+            if (trace) printf("[treeprint] At node %p (word='%s', count=%d)\n", (void*)p, p->word, p->count);
+            stack[sp++] = p;
+            p = p->left;
+        }
+        p = stack[--sp];
+        fprintf(out, "%4d %s\n", p->count, p->word);
+        p = p->right;
+    }
+}
+
 // Print the tree in-order, with debug prints
 void treeprint(const TNode *p) {
-    if (p != NULL) {
-        printf("[treeprint] At node %p (word='%s', count=%d)\n", (void*)p, p->word, p->count);
-        treeprint(p->left);
-        printf("%4d %s\n", p->count, p->word);
-        treeprint(p->right);
-    }
+    treeprint_to(p, stdout);
 }
 
-// Free the tree, with debug prints
+// Free the tree, with debug prints. Rotating left children up turns the tree into a
+// right-leaning list as it goes, so no stack is needed at all.
 void treefree(TNode *p) {
-    if (p) {
-        printf("[Free] Freeing node at %p (word='%s')\n", (void*)p, p->word);
-        treefree(p->left);
-        treefree(p->right);
-        free(p->word);
-        free(p);
+    while (p) {
+        if (p->left) {
+            TNode *l = p->left;
+            p->left = l->right;
+            l->right = p;
+            p = l;
+        } else {
+            TNode *next = p->right;
+            if (trace) printf("[Free] Freeing node at %p (word='%s')\n", (void*)p, p->word);
+            free(p->word);
+            free(p);
+            p = next;
+        }
+    }
+}
+
+/* ---------- Ranking by count ---------- */
+
+struct entry {               // a (word, count) record, for sorting and merging
+    char *word;
+    long count;
+};
+
+// qsort order for records: higher count first, ties in alphabetical order
+static int cmp_rank(const void *a, const void *b) {
+    const struct entry *x = (const struct entry *)a, *y = (const struct entry *)b;
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return strcmp(x->word, y->word);
+}
+
+// Offers e to a top-k heap of records (heap[0] is the lowest-ranked one kept)
+static void topk_offer(struct entry *heap, size_t *n, size_t k, struct entry e) {
+    size_t c;
+    if (*n < k) {
+        for (c = (*n)++; c > 0 && cmp_rank(&e, &heap[(c - 1) / 2]) > 0; c = (c - 1) / 2)
+            heap[c] = heap[(c - 1) / 2];
+    } else if (k > 0 && cmp_rank(&e, &heap[0]) < 0) {
+        for (c = 0;;) {
+            size_t l = 2 * c + 1, m = l;
+            if (l >= *n) break;
+            if (l + 1 < *n && cmp_rank(&heap[l + 1], &heap[l]) > 0) m = l + 1;
+            if (cmp_rank(&heap[m], &e) <= 0) break;
+            heap[c] = heap[m];
+            c = m;
+        }
+    } else {
+        return;
+    }
+    heap[c] = e;
+}
+
+// Does node a rank below node b (lower count, or same count and later word)?
+static int node_worse(const TNode *a, const TNode *b) {
+    return a->count != b->count ? a->count < b->count : strcmp(a->word, b->word) > 0;
+}
+
+static void top_place(size_t c, TNode *p) {
+    top_heap[c] = p;
+    p->heap_pos = (int)c;
+}
+
+static void top_sift_down(size_t c) {
+    TNode *p = top_heap[c];
+    for (;;) {
+        size_t l = 2 * c + 1, m = l;
+        if (l >= top_n) break;
+        if (l + 1 < top_n && node_worse(top_heap[l + 1], top_heap[l])) m = l + 1;
+        if (!node_worse(top_heap[m], p)) break;
+        top_place(c, top_heap[m]);
+        c = m;
+    }
+    top_place(c, p);
+}
+
+// Called whenever p's count goes up. Keeps top_heap equal to the top_k highest-ranked
+// nodes: only p's rank changed, and it only went up.
+static void top_update(TNode *p) {
+    if (p->heap_pos >= 0) {
+        top_sift_down(p->heap_pos);      // ranks higher now: moves away from the root
+    } else if (top_n < top_k) {
+        size_t c = top_n++;
+        for (; c > 0 && node_worse(p, top_heap[(c - 1) / 2]); c = (c - 1) / 2)
+            top_place(c, top_heap[(c - 1) / 2]);
+        top_place(c, p);
+    } else if (top_k > 0 && node_worse(top_heap[0], p)) {
+        top_heap[0]->heap_pos = -1;      // the lowest of the top K drops out
+        top_place(0, p);
+        top_sift_down(0);
+    }
+}
+
+// Starts keeping the top k nodes while counting (--top k)
+void top_start(size_t k) {
+    top_k = k;
+    top_n = 0;
+    top_heap = (TNode **)malloc((k ? k : 1) * sizeof(TNode *));
+    if (top_heap == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        exit(EXIT_FAILURE);
     }
 }
 
+void top_stop() {
+    free(top_heap);
+    top_heap = NULL;
+    top_n = top_k = 0;
+}
+
+// Copies the tree into a flat array of records in word order (words are borrowed)
+struct entry *tree_records(const TNode *p, size_t *n) {
+    const TNode *stack[MAX_HEIGHT];
+    size_t cap = 1024, k = 0;
+    int sp = 0;
+    struct entry *e = (struct entry *)malloc(cap * sizeof(*e));
+    while (e && (p != NULL || sp > 0)) {
+        while (p != NULL) {
+            stack[sp++] = p;
+            p = p->left;
+        }
+        p = stack[--sp];
+        if (k == cap) e = (struct entry *)realloc(e, (cap *= 2) * sizeof(*e));
+        if (e == NULL) break;
+        e[k++] = (struct entry){p->word, p->count};
+        p = p->right;
+    }
+    if (e == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *n = k;
+    return e;
+}
+
+// The k most frequent words by walking the whole tree with a k-entry heap: O(n log k)
+struct entry *tree_top(const TNode *p, size_t k, size_t *n) {
+    const TNode *stack[MAX_HEIGHT];
+    struct entry *heap = (struct entry *)malloc((k ? k : 1) * sizeof(*heap));
+    int sp = 0;
+    *n = 0;
+    while (heap && (p != NULL || sp > 0)) {
+        while (p != NULL) {
+            stack[sp++] = p;
+            p = p->left;
+        }
+        p = stack[--sp];
+        topk_offer(heap, n, k, (struct entry){p->word, p->count});
+        p = p->right;
+    }
+    return heap;
+}
+
+// Sorts records that are already in word order by count, highest first. A stable LSD
+// radix sort on the count bytes keeps equal counts in word order without comparing
+// any strings, in O(n) time.
+int sort_by_count(struct entry *e, size_t n) {
+    long max = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (e[i].count > max) max = e[i].count;
+    struct entry *tmp = (struct entry *)malloc((n ? n : 1) * sizeof(*tmp));
+    if (tmp == NULL) return -1;
+    // Sorting the keys max - count upwards puts the highest counts first
+    for (int shift = 0; shift == 0 || (max >> shift) != 0; shift += 8) {
+        size_t pos[256] = {0}, sum = 0;
+        for (size_t i = 0; i < n; ++i) pos[(max - e[i].count) >> shift & 0xff]++;
+        for (int b = 0; b < 256; ++b) {
+            size_t c = pos[b];
+            pos[b] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; ++i) tmp[pos[(max - e[i].count) >> shift & 0xff]++] = e[i];
+        memcpy(e, tmp, n * sizeof(*e));
+    }
+    free(tmp);
+    return 0;
+}
+
+static void print_records(const struct entry *e, size_t n, FILE *out) {
+    for (size_t i = 0; i < n; ++i)
+        fprintf(out, "%4ld %s\n", e[i].count, e[i].word);
+}
+
+// Prints the counts as the command line asked: alphabetical, by count, or the top K
+void print_counts(const TNode *root, FILE *out) {
+    struct entry *e;
+    size_t n;
+    if (top_heap) {
+        // Kept up to date while counting: just sort the K survivors
+        e = (struct entry *)malloc((top_n ? top_n : 1) * sizeof(*e));
+        for (n = 0; e && n < top_n; ++n) e[n] = (struct entry){top_heap[n]->word, top_heap[n]->count};
+    } else if (top_k) {
+        e = tree_top(root, top_k, &n);
+    } else if (order_count) {
+        e = tree_records(root, &n);
+    } else {
+        treeprint_to(root, out);
+        return;
+    }
+    if (e == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        return;
+    }
+    if (top_heap || top_k)
+        qsort(e, n, sizeof(*e), cmp_rank);   // only K records
+    else if (sort_by_count(e, n) != 0)
+        qsort(e, n, sizeof(*e), cmp_rank);
+    print_records(e, n, out);
+    free(e);
+}
+
 // Get next word from input (letters only, lowercased)
 int getword(char *word, int lim) {
     int c;
@@ -97,7 +532,7 @@ int getword(char *word, int lim) {
         return c;
     }
     *w++ = tolower(c);
-    while (--lim > 0) {
+    while (--lim > 1) {
         c = getchar();
         if (!isalnum(c)) {
             ungetc(c, stdin);
@@ -109,24 +544,2228 @@ int getword(char *word, int lim) {
     return 'a'; // LETTER
 }
 
-void run_demo() {
-    printf("Andrew M's Binary Tree Word Count Tutorial\n");
-    printf("------------------------------------------\n");
-    printf("Enter words (Ctrl+D to end):\n");
-    TNode *root = NULL;
-    char word[MAXWORD];
-    int t;
-    while ((t = getword(word, MAXWORD)) != EOF) {
-        if (isalpha(word[0]))
-            root = tree(root, word);
+/* ---------- Adaptive radix tree index ---------- */
+
+#define ART_PREFIX 8         // prefix bytes kept in a node; longer prefixes are read from a leaf
+
+enum { ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256 };
+
+typedef struct art_node {    // the header every inner node starts with
+    uint8_t type;            // ART_NODE4 ... ART_NODE256
+    uint16_t n;              // children
+    uint32_t prefix_len;     // bytes all keys below share, after the byte that led here
+    uint8_t prefix[ART_PREFIX];
+} ArtNode;
+
+typedef struct { ArtNode h; uint8_t keys[4]; void *child[4]; } ArtNode4;      // sorted keys
+typedef struct { ArtNode h; uint8_t keys[16]; void *child[16]; } ArtNode16;   // sorted, SSE2 search
+typedef struct { ArtNode h; uint8_t index[256]; void *child[48]; } ArtNode48; // byte -> slot + 1
+typedef struct { ArtNode h; void *child[256]; } ArtNode256;
+
+typedef struct art_leaf {    // one word: its count and its only copy
+    int count;
+    uint32_t len;
+    char word[];             // lowercased, NUL-terminated
+} ArtLeaf;
+
+typedef struct {
+    void *root;              // an ArtNode, or an ArtLeaf pointer with the low bit set
+    size_t n;                // distinct words
+} Art;
+
+#define ART_IS_LEAF(p) ((uintptr_t)(p) & 1)
+#define ART_LEAF(p) ((ArtLeaf *)((uintptr_t)(p) - 1))
+
+// Byte d of the key for w[0..len): lowercased, with a 0 after the last byte so that a
+// word sorts before the longer words it is a prefix of
+static inline uint8_t art_key(const char *w, size_t len, size_t d) {
+    return d < len ? (uint8_t)(w[d] | 0x20) : 0;
+}
+
+static void *art_alloc(size_t size) {
+    void *p = calloc(1, size);
+    if (p == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+static void *art_make_leaf(const char *w, size_t len, int n) {
+    ArtLeaf *l = (ArtLeaf *)art_alloc(sizeof(ArtLeaf) + len + 1);
+    l->count = n;
+    l->len = (uint32_t)len;
+    for (size_t i = 0; i < len; ++i) l->word[i] = w[i] | 0x20;
+    return (void *)((uintptr_t)l | 1);
+}
+
+// Slot holding the child for byte b, or NULL
+static void **art_find_child(ArtNode *nd, uint8_t b) {
+    switch (nd->type) {
+    case ART_NODE4: {
+        ArtNode4 *n4 = (ArtNode4 *)nd;
+        for (int i = 0; i < nd->n; ++i)
+            if (n4->keys[i] == b) return &n4->child[i];
+        return NULL;
+    }
+    case ART_NODE16: {
+        ArtNode16 *n16 = (ArtNode16 *)nd;
+#ifdef __SSE2__
+        __m128i eq = _mm_cmpeq_epi8(_mm_set1_epi8((char)b), _mm_loadu_si128((const __m128i *)n16->keys));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq) & ((1u << nd->n) - 1);
+        return mask ? &n16->child[__builtin_ctz(mask)] : NULL;
+#else
+        for (int i = 0; i < nd->n; ++i)
+            if (n16->keys[i] == b) return &n16->child[i];
+        return NULL;
+#endif
+    }
+    case ART_NODE48: {
+        ArtNode48 *n48 = (ArtNode48 *)nd;
+        return n48->index[b] ? &n48->child[n48->index[b] - 1] : NULL;
+    }
+    default: {
+        ArtNode256 *n256 = (ArtNode256 *)nd;
+        return n256->child[b] ? &n256->child[b] : NULL;
+    }
+    }
+}
+
+// Adds child c under byte b to the node at *ref, moving it to the next size up when full
+static void art_add_child(void **ref, ArtNode *nd, uint8_t b, void *c) {
+    if (nd->type == ART_NODE4 && nd->n == 4) {
+        ArtNode16 *big = (ArtNode16 *)art_alloc(sizeof(ArtNode16));
+        big->h = *nd;
+        big->h.type = ART_NODE16;
+        memcpy(big->keys, ((ArtNode4 *)nd)->keys, 4);
+        memcpy(big->child, ((ArtNode4 *)nd)->child, 4 * sizeof(void *));
+        free(nd);
+        *ref = nd = &big->h;
+    } else if (nd->type == ART_NODE16 && nd->n == 16) {
+        ArtNode48 *big = (ArtNode48 *)art_alloc(sizeof(ArtNode48));
+        big->h = *nd;
+        big->h.type = ART_NODE48;
+        for (int i = 0; i < 16; ++i) {
+            big->index[((ArtNode16 *)nd)->keys[i]] = (uint8_t)(i + 1);
+            big->child[i] = ((ArtNode16 *)nd)->child[i];
+        }
+        free(nd);
+        *ref = nd = &big->h;
+    } else if (nd->type == ART_NODE48 && nd->n == 48) {
+        ArtNode256 *big = (ArtNode256 *)art_alloc(sizeof(ArtNode256));
+        big->h = *nd;
+        big->h.type = ART_NODE256;
+        for (int b2 = 0; b2 < 256; ++b2)
+            if (((ArtNode48 *)nd)->index[b2]) big->child[b2] = ((ArtNode48 *)nd)->child[((ArtNode48 *)nd)->index[b2] - 1];
+        free(nd);
+        *ref = nd = &big->h;
+    }
+    if (nd->type == ART_NODE4 || nd->type == ART_NODE16) {
+        uint8_t *keys = nd->type == ART_NODE4 ? ((ArtNode4 *)nd)->keys : ((ArtNode16 *)nd)->keys;
+        void **child = nd->type == ART_NODE4 ? ((ArtNode4 *)nd)->child : ((ArtNode16 *)nd)->child;
+        int i = nd->n;
+        for (; i > 0 && keys[i - 1] > b; --i) {     // keep the keys sorted for in-order walks
+            keys[i] = keys[i - 1];
+            child[i] = child[i - 1];
+        }
+        keys[i] = b;
+        child[i] = c;
+    } else if (nd->type == ART_NODE48) {
+        ArtNode48 *n48 = (ArtNode48 *)nd;
+        n48->child[nd->n] = c;                      // slots fill in order: nothing is ever removed
+        n48->index[b] = (uint8_t)(nd->n + 1);
+    } else {
+        ((ArtNode256 *)nd)->child[b] = c;
+    }
+    nd->n++;
+}
+
+// Leftmost leaf below p (its key holds every prefix on the way down)
+static ArtLeaf *art_minimum(void *p) {
+    while (!ART_IS_LEAF(p)) {
+        ArtNode *nd = (ArtNode *)p;
+        if (nd->type == ART_NODE4) p = ((ArtNode4 *)nd)->child[0];
+        else if (nd->type == ART_NODE16) p = ((ArtNode16 *)nd)->child[0];
+        else if (nd->type == ART_NODE48) {
+            int b = 0;
+            while (!((ArtNode48 *)nd)->index[b]) b++;
+            p = ((ArtNode48 *)nd)->child[((ArtNode48 *)nd)->index[b] - 1];
+        } else {
+            int b = 0;
+            while (!((ArtNode256 *)nd)->child[b]) b++;
+            p = ((ArtNode256 *)nd)->child[b];
+        }
+    }
+    return ART_LEAF(p);
+}
+
+// Inserts w[0..len) (letters and digits, any case) or adds n to its count. Prefixes are
+// compressed: a node keeps the bytes its keys share, and a leaf hangs as high up as its
+// key is unique, so common prefixes are stored once and chains of one-child nodes never
+// appear.
+void art_add(Art *t, const char *w, size_t len, int n) {
+    void **ref = &t->root;
+    size_t depth = 0;
+    for (;;) {
+        void *p = *ref;
+        if (p == NULL) {
+            *ref = art_make_leaf(w, len, n);
+            t->n++;
+            return;
+        }
+        if (ART_IS_LEAF(p)) {
+            ArtLeaf *l = ART_LEAF(p);
+            size_t i = depth;
+            while (i <= len && i <= l->len && (uint8_t)l->word[i] == art_key(w, len, i)) i++;
+            if (i > len) {                      // the whole key matched, terminator included
+                l->count += n;
+                return;
+            }
+            // Two keys: a Node4 holds the bytes they share and branches where they differ
+            ArtNode4 *nn = (ArtNode4 *)art_alloc(sizeof(ArtNode4));
+            nn->h.type = ART_NODE4;
+            nn->h.prefix_len = (uint32_t)(i - depth);
+            memcpy(nn->h.prefix, l->word + depth, i - depth < ART_PREFIX ? i - depth : ART_PREFIX);
+            void *leaf = art_make_leaf(w, len, n);
+            *ref = &nn->h;
+            art_add_child(ref, &nn->h, (uint8_t)l->word[i], p);
+            art_add_child(ref, &nn->h, art_key(w, len, i), leaf);
+            t->n++;
+            return;
+        }
+        ArtNode *nd = (ArtNode *)p;
+        if (nd->prefix_len > 0) {
+            // Find where the key leaves the node's prefix; past ART_PREFIX bytes, compare a leaf
+            const char *full = nd->prefix_len > ART_PREFIX ? art_minimum(nd)->word + depth : NULL;
+            size_t m = 0;
+            while (m < nd->prefix_len
+                   && (uint8_t)(full ? full[m] : (char)nd->prefix[m]) == art_key(w, len, depth + m))
+                m++;
+            if (m < nd->prefix_len) {
+                // Split the prefix: a new Node4 keeps its first m bytes, the old node the rest
+                ArtNode4 *nn = (ArtNode4 *)art_alloc(sizeof(ArtNode4));
+                nn->h.type = ART_NODE4;
+                nn->h.prefix_len = (uint32_t)m;
+                memcpy(nn->h.prefix, full ? (const uint8_t *)full : nd->prefix, m < ART_PREFIX ? m : ART_PREFIX);
+                uint8_t b = full ? (uint8_t)full[m] : nd->prefix[m];
+                nd->prefix_len -= (uint32_t)(m + 1);
+                size_t keep = nd->prefix_len < ART_PREFIX ? nd->prefix_len : ART_PREFIX;
+                if (full) memcpy(nd->prefix, full + m + 1, keep);
+                else memmove(nd->prefix, nd->prefix + m + 1, keep);
+                *ref = &nn->h;
+                art_add_child(ref, &nn->h, b, nd);
+                art_add_child(ref, &nn->h, art_key(w, len, depth + m), art_make_leaf(w, len, n));
+                t->n++;
+                return;
+            }
+            depth += nd->prefix_len;
+        }
+        void **next = art_find_child(nd, art_key(w, len, depth));
+        if (next == NULL) {
+            art_add_child(ref, nd, art_key(w, len, depth), art_make_leaf(w, len, n));
+            t->n++;
+            return;
+        }
+        ref = next;
+        depth++;
+    }
+}
+
+struct art_cursor {          // an inner node being walked, and where its walk is
+    ArtNode *node;
+    int next;                // next child (Node4/16) or next byte (Node48/256) to look at
+};
+
+// Next child of c->node in byte order, or NULL when it has no more
+static void *art_next_child(struct art_cursor *c) {
+    ArtNode *nd = c->node;
+    switch (nd->type) {
+    case ART_NODE4:
+        return c->next < nd->n ? ((ArtNode4 *)nd)->child[c->next++] : NULL;
+    case ART_NODE16:
+        return c->next < nd->n ? ((ArtNode16 *)nd)->child[c->next++] : NULL;
+    case ART_NODE48:
+        for (; c->next < 256; ++c->next)
+            if (((ArtNode48 *)nd)->index[c->next])
+                return ((ArtNode48 *)nd)->child[((ArtNode48 *)nd)->index[c->next++] - 1];
+        return NULL;
+    default:
+        for (; c->next < 256; ++c->next)
+            if (((ArtNode256 *)nd)->child[c->next]) return ((ArtNode256 *)nd)->child[c->next++];
+        return NULL;
+    }
+}
+
+typedef void (*art_fn)(ArtLeaf *leaf, int depth, void *ctx);
+typedef void (*art_node_fn)(ArtNode *node, void *ctx);
+
+// Calls fn on every leaf in word order (with the number of inner nodes above it), using
+// an explicit stack, and node_fn (if set) on every inner node once all below it is done
+void art_walk(Art *t, art_fn fn, art_node_fn node_fn, void *ctx) {
+    struct art_cursor *stack = NULL;
+    int sp = 0, cap = 0;
+    void *p = t->root;
+    if (p == NULL) return;
+    if (ART_IS_LEAF(p)) {
+        fn(ART_LEAF(p), 0, ctx);
+        return;
+    }
+    for (;;) {
+        if (p != NULL && !ART_IS_LEAF(p)) {
+            if (sp == cap) {
+                cap = cap ? cap * 2 : 64;
+                stack = (struct art_cursor *)realloc(stack, cap * sizeof(*stack));
+                if (stack == NULL) {
+                    fprintf(stderr, "[Error] out of memory\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            stack[sp++] = (struct art_cursor){(ArtNode *)p, 0};
+        } else if (p != NULL) {
+            fn(ART_LEAF(p), sp, ctx);
+        }
+        if (sp == 0) break;
+        while ((p = art_next_child(&stack[sp - 1])) == NULL) {
+            if (node_fn) node_fn(stack[sp - 1].node, ctx);
+            if (--sp == 0) break;
+        }
+        if (p == NULL) break;
+    }
+    free(stack);
+}
+
+static void art_free_leaf(ArtLeaf *leaf, int depth, void *ctx) {
+    (void)depth;
+    (void)ctx;
+    free(leaf);
+}
+
+static void art_free_node(ArtNode *node, void *ctx) {
+    (void)ctx;
+    free(node);
+}
+
+void art_free(Art *t) {
+    art_walk(t, art_free_leaf, art_free_node, NULL);
+    t->root = NULL;
+    t->n = 0;
+}
+
+struct art_print_ctx {
+    FILE *out;
+    struct entry *e;         // --sort-count: every record; --top: a top_k heap
+    size_t n, cap;
+};
+
+static void art_print_leaf(ArtLeaf *leaf, int depth, void *ctx) {
+    struct art_print_ctx *c = (struct art_print_ctx *)ctx;
+    (void)depth;
+    if (top_k) {
+        topk_offer(c->e, &c->n, top_k, (struct entry){leaf->word, leaf->count});
+    } else if (order_count) {
+        if (c->n == c->cap) {
+            c->cap = c->cap ? c->cap * 2 : 1024;
+            if ((c->e = (struct entry *)realloc(c->e, c->cap * sizeof(*c->e))) == NULL) {
+                fprintf(stderr, "[Error] out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        c->e[c->n++] = (struct entry){leaf->word, leaf->count};
+    } else {
+        fprintf(c->out, "%4d %s\n", leaf->count, leaf->word);
+    }
+}
+
+// Prints the counts like print_counts() does for the tree
+void art_print(Art *t, FILE *out) {
+    struct art_print_ctx c = {out, NULL, 0, 0};
+    if (top_k && (c.e = (struct entry *)malloc(top_k * sizeof(*c.e))) == NULL) return;
+    art_walk(t, art_print_leaf, NULL, &c);
+    if (top_k)
+        qsort(c.e, c.n, sizeof(*c.e), cmp_rank);
+    else if (order_count && sort_by_count(c.e, c.n) != 0)
+        qsort(c.e, c.n, sizeof(*c.e), cmp_rank);
+    print_records(c.e, c.n, out);
+    free(c.e);
+}
+
+static void art_count_word(const char *w, size_t len, void *ctx) {
+    art_add((Art *)ctx, w, len, 1);
+}
+
+/* ---------- Block tokenizer ---------- */
+
+typedef void (*word_fn)(const char *w, size_t len, void *ctx);
+
+static int is_alnum(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26 || (unsigned char)(c - '0') < 10;
+}
+
+// One bit per byte of p[0..63]: 1 where the byte is a letter or digit
+static uint64_t alnum_mask64(const unsigned char *p) {
+#ifdef __SSE2__
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a'), zero = _mm_set1_epi8('0'), flip = _mm_set1_epi8((char)0x80);
+    const __m128i letters = _mm_set1_epi8((char)(-128 + 26)), digits = _mm_set1_epi8((char)(-128 + 10));
+    uint64_t m = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        // Unsigned "x - lo < n" as a signed compare: subtract, then flip the sign bit
+        __m128i l = _mm_xor_si128(_mm_sub_epi8(_mm_or_si128(x, case_bit), a), flip);
+        __m128i d = _mm_xor_si128(_mm_sub_epi8(x, zero), flip);
+        __m128i hit = _mm_or_si128(_mm_cmplt_epi8(l, letters), _mm_cmplt_epi8(d, digits));
+        m |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << (16 * i);
+    }
+    return m;
+#else
+    uint64_t m = 0;
+    for (int i = 0; i < 64; ++i)
+        m |= (uint64_t)is_alnum(p[i]) << i;
+    return m;
+#endif
+}
+
+// Hands a run of letters/digits to fn as a word, minus any digits in front
+static void emit_run(const char *s, const char *e, word_fn fn, void *ctx) {
+    while (s < e && (unsigned char)(*s - '0') < 10) s++;
+    if (s < e) fn(s, e - s, ctx);
+}
+
+// Calls fn for every word in buf[0..len), 64 bytes per step
+void tokenize(const char *buf, size_t len, word_fn fn, void *ctx) {
+    const unsigned char *p = (const unsigned char *)buf;
+    unsigned char tail[64];
+    uint64_t carry = 0;          // 1 if the byte before this block was a letter/digit
+    size_t run_start = 0;
+    for (size_t b = 0; b < len; b += 64) {
+        uint64_t m;
+        if (len - b >= 64) {
+            m = alnum_mask64(p + b);
+        } else {
+            memset(tail, ' ', sizeof(tail));     // pad the last block with non-word bytes
+            memcpy(tail, p + b, len - b);
+            m = alnum_mask64(tail);
+        }
+        uint64_t prev = (m << 1) | carry;        // bit i: was byte i-1 a letter/digit?
+        uint64_t starts = m & ~prev, ends = ~m & prev;
+        int open = (int)carry;   // a word from the previous block is still going
+        carry = m >> 63;
+        // Starts and ends alternate, so take them in turn
+        for (;;) {
+            if (open) {
+                if (!ends) break;
+                size_t e = b + __builtin_ctzll(ends);
+                ends &= ends - 1;
+                emit_run(buf + run_start, buf + (e < len ? e : len), fn, ctx);
+                open = 0;
+            } else {
+                if (!starts) break;
+                run_start = b + __builtin_ctzll(starts);
+                starts &= starts - 1;
+                open = 1;
+            }
+        }
+    }
+    if (carry && len > 0)        // the buffer ends in the middle of a word
+        emit_run(buf + run_start, buf + len, fn, ctx);
+}
+
+// Tokenizes a whole file through mmap(). Returns 0 on success.
+int tokenize_file(const char *path, word_fn fn, void *ctx) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    madvise(p, st.st_size, MADV_SEQUENTIAL);   // read ahead aggressively
+    tokenize((const char *)p, st.st_size, fn, ctx);
+    munmap(p, st.st_size);
+    return 0;
+}
+
+// Tokenizes a stream (stdin, a pipe) in READ_BLOCK reads. A word cut by the end of a
+// block is moved to the front and finished by the next read.
+int tokenize_fd(int fd, word_fn fn, void *ctx) {
+    size_t cap = READ_BLOCK, len = 0;
+    char *buf = (char *)malloc(cap);
+    if (buf == NULL) return -1;
+    for (;;) {
+        if (len == cap) {
+            char *bigger = (char *)realloc(buf, cap * 2);   // one word bigger than a block
+            if (bigger == NULL) { free(buf); return -1; }
+            buf = bigger;
+            cap *= 2;
+        }
+        ssize_t got = read(fd, buf + len, cap - len);
+        if (got < 0) {
+            perror("read");
+            free(buf);
+            return -1;
+        }
+        if (got == 0) {
+            tokenize(buf, len, fn, ctx);
+            break;
+        }
+        len += (size_t)got;
+        size_t cut = len;
+        while (cut > 0 && is_alnum((unsigned char)buf[cut - 1])) cut--;
+        if (cut == 0) continue;          // no word boundary yet: read more
+        tokenize(buf, cut, fn, ctx);
+        memmove(buf, buf + cut, len - cut);
+        len -= cut;
+    }
+    free(buf);
+    return 0;
+}
+
+static void count_word(const char *w, size_t len, void *ctx) {
+    TNode **root = (TNode **)ctx;
+    *root = tree_n(*root, w, len);
+}
+
+void run_demo(int nfiles, char **files) {
+    if (trace) {
+        printf("Andrew M's Binary Tree Word Count Tutorial\n");
+        printf("------------------------------------------\n");
+        if (nfiles == 0) printf("Enter words (Ctrl+D to end):\n");
+    }
+    if (use_art) {
+        Art t = {NULL, 0};
+        if (nfiles == 0)
+            tokenize_fd(STDIN_FILENO, art_count_word, &t);
+        for (int i = 0; i < nfiles; ++i)
+            tokenize_file(files[i], art_count_word, &t);
+        if (trace) printf("\nWord frequencies (%s, radix tree):\n", top_k ? "most frequent" : order_count ? "by count" : "in order");
+        art_print(&t, stdout);
+        art_free(&t);
+        return;
     }
-    printf("\nWord frequencies (in order):\n");
-    treeprint(root);
+    TNode *root = NULL;
+    if (nfiles == 0)
+        tokenize_fd(STDIN_FILENO, count_word, &root);
+    for (int i = 0; i < nfiles; ++i)
+        tokenize_file(files[i], count_word, &root);
+    if (trace) printf("\nWord frequencies (%s):\n", top_k ? "most frequent" : order_count ? "by count" : "in order");
+    print_counts(root, stdout);
+    top_n = 0;
     treefree(root);
 }
 
-int main() {
-    run_demo();
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ---------- Counting with threads ---------- */
+
+struct span {                // a piece of input that starts and ends between words
+    const char *p;
+    size_t len;
+};
+
+struct part {                // one thread's chunks, and its counts in word order
+    const struct span *spans;
+    int nspans, step;        // spans[0], spans[step], spans[2 * step], ...
+    struct entry *entries;
+    size_t n;
+};
+
+struct merge_job {           // one range of words [lo, hi), merged by one thread
+    const struct part *parts;
+    int nparts;
+    const char *lo, *hi;     // NULL: no bound on that side
+    char *out;               // formatted "%4ld %s\n" lines
+    size_t len, cap;
+    struct entry *recs;      // --sort-count: every record; --top: a top_k heap
+    size_t nrecs, reccap;
+};
+
+// Cuts buf into about `pieces` spans that end on a non-word byte and appends them
+static void add_spans(const char *buf, size_t len, int pieces, struct span **spans, int *n, int *cap) {
+    size_t start = 0;
+    for (int i = 1; i <= pieces && start < len; ++i) {
+        size_t end = i == pieces ? len : len / pieces * i;
+        if (end < start) end = start;
+        while (end < len && is_alnum((unsigned char)buf[end])) end++;
+        if (end == start) continue;
+        if (*n == *cap) {
+            *cap = *cap ? *cap * 2 : 64;
+            *spans = (struct span *)realloc(*spans, *cap * sizeof(**spans));
+            if (*spans == NULL) {
+                fprintf(stderr, "[Error] out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        (*spans)[(*n)++] = (struct span){buf + start, end - start};
+        start = end;
+    }
+}
+
+// Turns a tree into an array in word order. This is the treefree() walk, which visits
+// nodes in order: each node is freed, its word moves to the array.
+static struct entry *flatten(TNode *p, size_t *n) {
+    size_t cap = 1024, k = 0;
+    struct entry *e = (struct entry *)malloc(cap * sizeof(*e));
+    while (p && e) {
+        if (p->left) {
+            TNode *l = p->left;
+            p->left = l->right;
+            l->right = p;
+            p = l;
+        } else {
+            if (k == cap) {
+                cap *= 2;
+                e = (struct entry *)realloc(e, cap * sizeof(*e));
+                if (e == NULL) break;
+            }
+            e[k].word = p->word;
+            e[k].count = p->count;
+            k++;
+            TNode *next = p->right;
+            free(p);
+            p = next;
+        }
+    }
+    if (e == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *n = k;
+    return e;
+}
+
+static void *count_part(void *arg) {
+    struct part *pt = (struct part *)arg;
+    TNode *root = NULL;
+    for (int i = 0; i < pt->nspans; i += pt->step)
+        tokenize(pt->spans[i].p, pt->spans[i].len, count_word, &root);
+    pt->entries = flatten(root, &pt->n);
+    return NULL;
+}
+
+// First index in e[0..n) whose word is >= w (n for w == NULL, meaning "past the end")
+static size_t lower_bound(const struct entry *e, size_t n, const char *w) {
+    size_t lo = 0, hi = n;
+    if (w == NULL) return n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(e[mid].word, w) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void job_print(struct merge_job *j, long count, const char *word) {
+    size_t need = strlen(word) + 24;
+    if (j->len + need > j->cap) {
+        j->cap = (j->cap + need) * 2;
+        j->out = (char *)realloc(j->out, j->cap);
+        if (j->out == NULL) {
+            fprintf(stderr, "[Error] out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    j->len += sprintf(j->out + j->len, "%4ld %s\n", count, word);
+}
+
+// Takes one merged (word, count): printed for alphabetical order, kept for the others
+static void job_append(struct merge_job *j, long count, char *word) {
+    if (top_k) {
+        if (j->recs == NULL && (j->recs = (struct entry *)malloc(top_k * sizeof(struct entry))) == NULL) {
+            fprintf(stderr, "[Error] out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        topk_offer(j->recs, &j->nrecs, top_k, (struct entry){word, count});
+    } else if (order_count) {
+        if (j->nrecs == j->reccap) {
+            j->reccap = j->reccap ? j->reccap * 2 : 1024;
+            j->recs = (struct entry *)realloc(j->recs, j->reccap * sizeof(struct entry));
+            if (j->recs == NULL) {
+                fprintf(stderr, "[Error] out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        j->recs[j->nrecs++] = (struct entry){word, count};
+    } else {
+        job_print(j, count, word);
+    }
+}
+
+// k-way merge of one word range of every part: a min-heap of cursors, smallest word on top
+static void *merge_range(void *arg) {
+    struct merge_job *j = (struct merge_job *)arg;
+    size_t pos[MAX_THREADS], end[MAX_THREADS];
+    int heap[MAX_THREADS], hn = 0;
+#define CUR(i) (j->parts[i].entries[pos[i]].word)
+    for (int i = 0; i < j->nparts; ++i) {
+        const struct part *pt = &j->parts[i];
+        pos[i] = j->lo ? lower_bound(pt->entries, pt->n, j->lo) : 0;
+        end[i] = lower_bound(pt->entries, pt->n, j->hi);
+        if (pos[i] < end[i]) {
+            int c = hn++;            // sift up
+            while (c > 0 && strcmp(CUR(i), CUR(heap[(c - 1) / 2])) < 0) {
+                heap[c] = heap[(c - 1) / 2];
+                c = (c - 1) / 2;
+            }
+            heap[c] = i;
+        }
+    }
+    while (hn > 0) {
+        char *w = CUR(heap[0]);
+        long total = 0;
+        do {
+            int i = heap[0];
+            total += j->parts[i].entries[pos[i]].count;
+            if (++pos[i] == end[i]) i = heap[--hn];    // cursor used up: last one takes its place
+            int c = 0;               // sift down
+            for (;;) {
+                int l = 2 * c + 1, m = c;
+                if (l >= hn) break;
+                if (strcmp(CUR(heap[l]), CUR(i)) < 0) m = l;
+                if (l + 1 < hn && strcmp(CUR(heap[l + 1]), m == c ? CUR(i) : CUR(heap[m])) < 0) m = l + 1;
+                if (m == c) break;
+                heap[c] = heap[m];
+                c = m;
+            }
+            if (hn > 0) heap[c] = i;
+        } while (hn > 0 && strcmp(CUR(heap[0]), w) == 0);
+        job_append(j, total, w);
+    }
+#undef CUR
+    return NULL;
+}
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Counts the words of all spans with nthreads threads. Returns nthreads merge jobs whose
+// outputs, in order, are the full word list; free them with free_jobs().
+struct merge_job *count_parallel(const struct span *spans, int nspans, int nthreads,
+                                 double *t_count, double *t_merge) {
+    pthread_t tid[MAX_THREADS];
+    struct part *parts = (struct part *)calloc(nthreads, sizeof(*parts));
+    struct merge_job *jobs = (struct merge_job *)calloc(nthreads, sizeof(*jobs));
+    const char **samples = (const char **)malloc((size_t)nthreads * nthreads * SAMPLES_PER_RANGE * sizeof(char *));
+    if (!parts || !jobs || !samples) {
+        fprintf(stderr, "[Error] out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    double t0 = now_sec();
+    for (int t = 0; t < nthreads; ++t) {
+        parts[t] = (struct part){t < nspans ? spans + t : NULL, t < nspans ? nspans - t : 0, nthreads, NULL, 0};
+        pthread_create(&tid[t], NULL, count_part, &parts[t]);
+    }
+    for (int t = 0; t < nthreads; ++t) pthread_join(tid[t], NULL);
+    double t1 = now_sec();
+
+    // Splitters: sort evenly spaced samples from every part, take every nthreads-th
+    size_t ns = 0;
+    for (int t = 0; t < nthreads; ++t)
+        for (size_t i = 0; parts[t].n > 0 && i < (size_t)nthreads * SAMPLES_PER_RANGE; ++i)
+            samples[ns++] = parts[t].entries[parts[t].n * i / (nthreads * SAMPLES_PER_RANGE)].word;
+    qsort(samples, ns, sizeof(char *), cmp_str);
+    for (int t = 0; t < nthreads; ++t) {
+        jobs[t].parts = parts;
+        jobs[t].nparts = nthreads;
+        jobs[t].lo = t == 0 || ns == 0 ? NULL : samples[ns * t / nthreads];
+        jobs[t].hi = t == nthreads - 1 || ns == 0 ? NULL : samples[ns * (t + 1) / nthreads];
+    }
+    for (int t = 0; t < nthreads; ++t) pthread_create(&tid[t], NULL, merge_range, &jobs[t]);
+    for (int t = 0; t < nthreads; ++t) pthread_join(tid[t], NULL);
+
+    if (top_k || order_count) {
+        // Gather every job's records (at most top_k each for --top), rank them, print to job 0
+        size_t total = 0, n = 0;
+        for (int t = 0; t < nthreads; ++t) total += jobs[t].nrecs;
+        struct entry *all = (struct entry *)malloc((total ? total : 1) * sizeof(*all));
+        if (all == NULL) {
+            fprintf(stderr, "[Error] out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int t = 0; t < nthreads; ++t) {
+            if (jobs[t].nrecs)       // a job with no records may have recs == NULL
+                memcpy(all + n, jobs[t].recs, jobs[t].nrecs * sizeof(*all));
+            n += jobs[t].nrecs;
+            free(jobs[t].recs);
+            jobs[t].recs = NULL;
+            jobs[t].nrecs = jobs[t].reccap = 0;
+        }
+        qsort(all, n, sizeof(*all), cmp_rank);
+        if (top_k && n > top_k) n = top_k;
+        for (size_t i = 0; i < n; ++i) job_print(&jobs[0], all[i].count, all[i].word);
+        free(all);
+    }
+    double t2 = now_sec();
+
+    for (int t = 0; t < nthreads; ++t) {
+        for (size_t i = 0; i < parts[t].n; ++i) free(parts[t].entries[i].word);
+        free(parts[t].entries);
+        jobs[t].parts = NULL;
+        jobs[t].lo = jobs[t].hi = NULL;
+    }
+    free(parts);
+    free(samples);
+    if (t_count) *t_count = t1 - t0;
+    if (t_merge) *t_merge = t2 - t1;
+    return jobs;
+}
+
+void free_jobs(struct merge_job *jobs, int n) {
+    for (int t = 0; t < n; ++t) free(jobs[t].out);
+    free(jobs);
+}
+
+// Reads all of fd into one buffer (stdin for -j: threads need the whole input up front)
+static char *slurp(int fd, size_t *len) {
+    size_t cap = READ_BLOCK, n = 0;
+    char *buf = (char *)malloc(cap);
+    ssize_t got;
+    while (buf && (got = read(fd, buf + n, cap - n)) > 0) {
+        n += (size_t)got;
+        if (n == cap) buf = (char *)realloc(buf, cap *= 2);
+    }
+    if (buf == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *len = n;
+    return buf;
+}
+
+// -j N: count FILEs (or stdin) with N threads and print the merged word list
+int run_parallel(int nfiles, char **files, int nthreads) {
+    struct span *spans = NULL;
+    int nspans = 0, cap = 0;
+    void **maps = (void **)calloc(nfiles + 1, sizeof(void *));
+    size_t *sizes = (size_t *)calloc(nfiles + 1, sizeof(size_t));
+    char *in = NULL;
+    if (nfiles == 0) {
+        in = slurp(STDIN_FILENO, &sizes[0]);
+        add_spans(in, sizes[0], nthreads * 4, &spans, &nspans, &cap);
+    }
+    for (int i = 0; i < nfiles; ++i) {
+        int fd = open(files[i], O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) < 0) {
+            perror(files[i]);
+            if (fd >= 0) close(fd);
+            continue;
+        }
+        if (st.st_size > 0) {
+            maps[i] = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (maps[i] == MAP_FAILED) {
+                perror(files[i]);
+                maps[i] = NULL;
+            } else {
+                sizes[i] = st.st_size;
+                // More chunks than threads, so a slow chunk does not hold everyone up
+                add_spans((const char *)maps[i], sizes[i], nthreads * 4, &spans, &nspans, &cap);
+            }
+        }
+        close(fd);
+    }
+    struct merge_job *jobs = count_parallel(spans, nspans, nthreads, NULL, NULL);
+    for (int t = 0; t < nthreads; ++t)
+        if (jobs[t].len > 0) fwrite(jobs[t].out, 1, jobs[t].len, stdout);
+    free_jobs(jobs, nthreads);
+    for (int i = 0; i < nfiles; ++i)
+        if (maps[i]) munmap(maps[i], sizes[i]);
+    free(in);
+    free(maps);
+    free(sizes);
+    free(spans);
+    return 0;
+}
+
+/* ---------- Approximate counting ---------- */
+
+#define CMS_DEPTH 4              // Count-Min rows: an estimate breaks its bound with probability e^-4
+#define HEAVY_DEFAULT 20         // heavy hitters kept when --top is not given
+#define SKETCH_MAGIC "WCSKETCH"
+
+struct sketch {
+    size_t width;            // counters in each Count-Min row
+    int hll_bits;            // HyperLogLog has 1 << hll_bits registers
+    uint32_t *counters;      // CMS_DEPTH rows of counters, one after the other
+    uint8_t *registers;      // HyperLogLog: per bucket, the highest hash rank seen
+    uint64_t total;          // words counted
+    size_t k, n;             // heavy hitters: slots, and slots in use
+    uint32_t *heap;          // slots in use, a min-heap on their estimates
+    uint32_t *est;           // per slot: the word's estimate when it was last seen
+    uint32_t *pos;           // per slot: its index in heap
+    uint64_t *hash;          // per slot: hash of the word, to find it again
+    char (*word)[MAXWORD];   // per slot: the word, lowercased (cut to MAXWORD - 1 characters)
+};
+
+struct sketch_header {       // a sketch file: this, then counters, registers and the slots
+    char magic[8];
+    uint64_t width, total;
+    uint32_t hll_bits, k, n, pad;
+};
+
+// 64-bit hash of a word, ignoring case (words are letters and digits, so |0x20 lowercases)
+static uint64_t word_hash(const char *w, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ len, v;
+    for (; len >= 8; w += 8, len -= 8) {
+        memcpy(&v, w, 8);
+        h = (h ^ (v | 0x2020202020202020ull)) * 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 29;
+    }
+    if (len > 0) {
+        v = 0;
+        memcpy(&v, w, len);
+        h = (h ^ (v | 0x2020202020202020ull >> (64 - 8 * len))) * 0xbf58476d1ce4e5b9ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 33);
+}
+
+// Counter for hash h in a row; each row mixes h differently, so words collide independently
+static inline size_t cms_index(const struct sketch *s, uint64_t h, int row) {
+    h += (uint64_t)(row + 1) * 0x9E3779B97F4A7C15ull;
+    h = (h ^ (h >> 31)) * 0xd6e8feb86659fd93ull;
+    return row * s->width + (size_t)((unsigned __int128)h * s->width >> 64);   // h scaled to [0, width)
+}
+
+// Estimated count: every counter for the word is at least its count, so take the smallest
+static uint32_t cms_estimate(const struct sketch *s, uint64_t h) {
+    uint32_t min = UINT32_MAX;
+    for (int r = 0; r < CMS_DEPTH; ++r)
+        if (s->counters[cms_index(s, h, r)] < min) min = s->counters[cms_index(s, h, r)];
+    return min;
+}
+
+// Counts one more of hash h with a conservative update: only the counters at the minimum
+// go up. The others already cover the new count, and leaving them lowers everyone's error.
+static uint32_t cms_add(struct sketch *s, uint64_t h) {
+    size_t at[CMS_DEPTH];
+    uint32_t min = UINT32_MAX;
+    for (int r = 0; r < CMS_DEPTH; ++r) {
+        at[r] = cms_index(s, h, r);
+        if (s->counters[at[r]] < min) min = s->counters[at[r]];
+    }
+    if (min == UINT32_MAX) return min;      // saturated
+    for (int r = 0; r < CMS_DEPTH; ++r)
+        if (s->counters[at[r]] == min) s->counters[at[r]] = min + 1;
+    return min + 1;
+}
+
+// HyperLogLog: the top bits pick a register, which keeps the highest rank (leading zeros
+// + 1) of the remaining bits
+static void hll_add(struct sketch *s, uint64_t h) {
+    size_t b = (size_t)(h >> (64 - s->hll_bits));
+    uint64_t rest = h << s->hll_bits | 1ull << (s->hll_bits - 1);
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (rank > s->registers[b]) s->registers[b] = rank;
+}
+
+// Estimated number of distinct words (linear counting while many registers are empty)
+double hll_estimate(const struct sketch *s) {
+    size_t m = (size_t)1 << s->hll_bits, zeros = 0;
+    double sum = 0;
+    for (size_t i = 0; i < m; ++i) {
+        sum += ldexp(1.0, -s->registers[i]);
+        zeros += s->registers[i] == 0;
+    }
+    double e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (e <= 2.5 * m && zeros > 0) e = m * log((double)m / zeros);
+    return e;
+}
+
+static void heavy_place(struct sketch *s, size_t i, uint32_t slot) {
+    s->heap[i] = slot;
+    s->pos[slot] = (uint32_t)i;
+}
+
+static void heavy_sift_down(struct sketch *s, size_t i) {
+    uint32_t slot = s->heap[i];
+    for (;;) {
+        size_t l = 2 * i + 1, m = l;
+        if (l >= s->n) break;
+        if (l + 1 < s->n && s->est[s->heap[l + 1]] < s->est[s->heap[l]]) m = l + 1;
+        if (s->est[s->heap[m]] >= s->est[slot]) break;
+        heavy_place(s, i, s->heap[m]);
+        i = m;
+    }
+    heavy_place(s, i, slot);
+}
+
+// Offers a word with its new estimate to the heavy hitters. A word's estimate never goes
+// down, so one that is not above the smallest kept estimate cannot change anything.
+static void heavy_offer(struct sketch *s, uint64_t h, const char *w, size_t len, uint32_t est) {
+    size_t slot, i;
+    if (s->k == 0 || (s->n == s->k && est <= s->est[s->heap[0]])) return;
+    for (slot = 0; slot < s->n; ++slot) {
+        if (s->hash[slot] == h) {
+            s->est[slot] = est;
+            heavy_sift_down(s, s->pos[slot]);
+            return;
+        }
+    }
+    if (s->n < s->k) {
+        slot = s->n++;
+        for (i = slot; i > 0 && s->est[s->heap[(i - 1) / 2]] > est; i = (i - 1) / 2)
+            heavy_place(s, i, s->heap[(i - 1) / 2]);
+    } else {
+        slot = s->heap[0];                  // the smallest estimate drops out
+        i = 0;
+    }
+    s->est[slot] = est;
+    s->hash[slot] = h;
+    if (len > MAXWORD - 1) len = MAXWORD - 1;
+    for (size_t c = 0; c < len; ++c) s->word[slot][c] = w[c] | 0x20;
+    s->word[slot][len] = '\0';
+    heavy_place(s, i, (uint32_t)slot);
+    if (i == 0) heavy_sift_down(s, 0);
+}
+
+void sketch_free(struct sketch *s) {
+    free(s->counters);
+    free(s->registers);
+    free(s->heap);
+    free(s->est);
+    free(s->pos);
+    free(s->hash);
+    free(s->word);
+    memset(s, 0, sizeof(*s));
+}
+
+static int sketch_alloc(struct sketch *s, size_t width, int hll_bits, size_t k) {
+    memset(s, 0, sizeof(*s));
+    s->width = width;
+    s->hll_bits = hll_bits;
+    s->k = k;
+    s->counters = (uint32_t *)calloc(CMS_DEPTH * width, sizeof(uint32_t));
+    s->registers = (uint8_t *)calloc((size_t)1 << hll_bits, 1);
+    s->heap = (uint32_t *)malloc((k ? k : 1) * sizeof(uint32_t));
+    s->est = (uint32_t *)malloc((k ? k : 1) * sizeof(uint32_t));
+    s->pos = (uint32_t *)malloc((k ? k : 1) * sizeof(uint32_t));
+    s->hash = (uint64_t *)malloc((k ? k : 1) * sizeof(uint64_t));
+    s->word = (char (*)[MAXWORD])malloc((k ? k : 1) * MAXWORD);
+    if (!s->counters || !s->registers || !s->heap || !s->est || !s->pos || !s->hash || !s->word) {
+        sketch_free(s);
+        return -1;
+    }
+    return 0;
+}
+
+// Bytes a sketch of this shape uses
+size_t sketch_bytes(const struct sketch *s) {
+    return CMS_DEPTH * s->width * sizeof(uint32_t) + ((size_t)1 << s->hll_bits)
+           + s->k * (3 * sizeof(uint32_t) + sizeof(uint64_t) + MAXWORD);
+}
+
+// Sizes a sketch to fit in budget bytes with k heavy hitters: about 1/64 of the budget
+// for HyperLogLog registers (128 to 65536 of them), the rest for Count-Min counters. Returns -1 if the budget is too small.
+int sketch_init(struct sketch *s, size_t budget, size_t k) {
+    size_t heavy = k * (3 * sizeof(uint32_t) + sizeof(uint64_t) + MAXWORD);
+    int hll_bits = 7;
+    while (hll_bits < 16 && ((size_t)1 << (hll_bits + 1)) <= budget / 64) hll_bits++;
+    if (heavy + ((size_t)1 << hll_bits) >= budget) return -1;
+    size_t left = budget - heavy - ((size_t)1 << hll_bits);
+    size_t width = left / (CMS_DEPTH * sizeof(uint32_t));
+    if (width < 16) return -1;
+    return sketch_alloc(s, width, hll_bits, k);
+}
+
+static void sketch_word(const char *w, size_t len, void *ctx) {
+    struct sketch *s = (struct sketch *)ctx;
+    uint64_t h = word_hash(w, len);
+    s->total++;
+    hll_add(s, h);
+    heavy_offer(s, h, w, len, cms_add(s, h));
+}
+
+int sketch_save(const struct sketch *s, const char *path) {
+    FILE *f = fopen(path, "wb");
+    struct sketch_header hd;
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    memcpy(hd.magic, SKETCH_MAGIC, 8);
+    hd.width = s->width;
+    hd.hll_bits = (uint32_t)s->hll_bits;
+    hd.k = (uint32_t)s->k;
+    hd.n = (uint32_t)s->n;
+    hd.pad = 0;
+    hd.total = s->total;
+    size_t ncounters = CMS_DEPTH * s->width;
+    int ok = fwrite(&hd, sizeof(hd), 1, f) == 1
+             && fwrite(s->counters, sizeof(uint32_t), ncounters, f) == ncounters
+             && fwrite(s->registers, 1, (size_t)1 << s->hll_bits, f) == (size_t)1 << s->hll_bits
+             && fwrite(s->est, sizeof(uint32_t), s->n, f) == s->n
+             && fwrite(s->hash, sizeof(uint64_t), s->n, f) == s->n
+             && fwrite(s->word, MAXWORD, s->n, f) == s->n;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "[Error] %s: write failed\n", path);
+    return ok ? 0 : -1;
+}
+
+int sketch_load(struct sketch *s, const char *path) {
+    FILE *f = fopen(path, "rb");
+    struct sketch_header hd;
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    if (fread(&hd, sizeof(hd), 1, f) != 1 || memcmp(hd.magic, SKETCH_MAGIC, 8) != 0 || hd.width < 16
+        || hd.width > ((uint64_t)1 << 40) || hd.hll_bits < 7 || hd.hll_bits > 16 || hd.n > hd.k
+        || sketch_alloc(s, (size_t)hd.width, (int)hd.hll_bits, hd.k) != 0) {
+        fprintf(stderr, "[Error] %s: not a sketch file\n", path);
+        fclose(f);
+        return -1;
+    }
+    s->total = hd.total;
+    s->n = hd.n;
+    size_t ncounters = CMS_DEPTH * s->width;
+    int ok = fread(s->counters, sizeof(uint32_t), ncounters, f) == ncounters
+             && fread(s->registers, 1, (size_t)1 << s->hll_bits, f) == (size_t)1 << s->hll_bits
+             && fread(s->est, sizeof(uint32_t), s->n, f) == s->n
+             && fread(s->hash, sizeof(uint64_t), s->n, f) == s->n
+             && fread(s->word, MAXWORD, s->n, f) == s->n;
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "[Error] %s: file is cut short\n", path);
+        sketch_free(s);
+        return -1;
+    }
+    for (size_t i = 0; i < s->n; ++i) {
+        s->word[i][MAXWORD - 1] = '\0';
+        heavy_place(s, i, (uint32_t)i);
+    }
+    for (size_t i = s->n / 2; i-- > 0;) heavy_sift_down(s, i);
+    return 0;
+}
+
+// Adds sketch b into a. Registers take the larger value, which gives exactly the
+// HyperLogLog of both inputs together. Counters add up: conservative updates are not
+// additive, so this is not the sketch one run would build, but it still never undercounts
+// and keeps the same bound. The heavy hitters of both are re-estimated against the merged
+// counters and the best a->k are kept.
+int sketch_merge(struct sketch *a, const struct sketch *b) {
+    if (a->width != b->width || a->hll_bits != b->hll_bits) return -1;
+    size_t ncounters = CMS_DEPTH * a->width, m = (size_t)1 << a->hll_bits;
+    for (size_t i = 0; i < ncounters; ++i) {
+        uint64_t sum = (uint64_t)a->counters[i] + b->counters[i];
+        a->counters[i] = sum > UINT32_MAX ? UINT32_MAX : (uint32_t)sum;
+    }
+    for (size_t i = 0; i < m; ++i)
+        if (b->registers[i] > a->registers[i]) a->registers[i] = b->registers[i];
+    a->total += b->total;
+
+    size_t nc = a->n + b->n;
+    uint64_t *hash = (uint64_t *)malloc((nc ? nc : 1) * sizeof(uint64_t));
+    char (*word)[MAXWORD] = (char (*)[MAXWORD])malloc((nc ? nc : 1) * MAXWORD);
+    if (hash == NULL || word == NULL) {
+        free(hash);
+        free(word);
+        return -1;
+    }
+    memcpy(hash, a->hash, a->n * sizeof(uint64_t));
+    memcpy(hash + a->n, b->hash, b->n * sizeof(uint64_t));
+    memcpy(word, a->word, a->n * MAXWORD);
+    memcpy(word + a->n, b->word, b->n * MAXWORD);
+    a->n = 0;
+    for (size_t i = 0; i < nc; ++i)
+        heavy_offer(a, hash[i], word[i], strlen(word[i]), cms_estimate(a, hash[i]));
+    free(hash);
+    free(word);
+    return 0;
+}
+
+// Prints the sketch's error bounds and its heavy hitters, most frequent first
+void sketch_print(const struct sketch *s, FILE *out) {
+    size_t width = s->width, m = (size_t)1 << s->hll_bits;
+    if (trace) {
+        fprintf(out, "words: %llu\n", (unsigned long long)s->total);
+        fprintf(out, "distinct words: ~%.0f (HyperLogLog, %zu registers, standard error %.2f%%)\n",
+                hll_estimate(s), m, 104.0 / sqrt((double)m));
+        fprintf(out, "counts below: at most %.0f too high, each with probability %.1f%% "
+                "(Count-Min, %d x %zu counters)\n",
+                exp(1.0) / width * s->total, 100 * (1 - exp(-CMS_DEPTH)), CMS_DEPTH, width);
+        fprintf(out, "memory: %zu bytes\n\nMost frequent words (estimated):\n", sketch_bytes(s));
+    }
+    struct entry *e = (struct entry *)malloc((s->n ? s->n : 1) * sizeof(*e));
+    if (e == NULL) return;
+    for (size_t i = 0; i < s->n; ++i) e[i] = (struct entry){s->word[i], s->est[i]};
+    qsort(e, s->n, sizeof(*e), cmp_rank);
+    print_records(e, s->n, out);
+    free(e);
+}
+
+static size_t parse_size(const char *arg) {
+    char *end;
+    double v = strtod(arg, &end);
+    if (*end == 'k' || *end == 'K') v *= 1 << 10;
+    else if (*end == 'm' || *end == 'M') v *= 1 << 20;
+    else if (*end == 'g' || *end == 'G') v *= 1 << 30;
+    return v > 0 ? (size_t)v : 0;
+}
+
+// --approx: counts FILEs (or stdin) into a sketch of budget bytes, or with merge, combines
+// the sketch files named in files. Prints the result, and saves it when save is set.
+int run_approx(int nfiles, char **files, size_t budget, const char *save, int merge) {
+    struct sketch s, t;
+    if (merge) {
+        if (nfiles == 0) {
+            fprintf(stderr, "[Error] --merge needs sketch files\n");
+            return EXIT_FAILURE;
+        }
+        if (sketch_load(&s, files[0]) != 0) return EXIT_FAILURE;
+        for (int i = 1; i < nfiles; ++i) {
+            if (sketch_load(&t, files[i]) != 0) {
+                sketch_free(&s);
+                return EXIT_FAILURE;
+            }
+            int err = sketch_merge(&s, &t);
+            sketch_free(&t);
+            if (err != 0) {
+                fprintf(stderr, "[Error] %s: built with a different --approx budget than %s\n", files[i], files[0]);
+                sketch_free(&s);
+                return EXIT_FAILURE;
+            }
+        }
+    } else {
+        if (sketch_init(&s, budget, top_k ? top_k : HEAVY_DEFAULT) != 0) {
+            fprintf(stderr, "[Error] --approx %zu bytes is too small (or out of memory)\n", budget);
+            return EXIT_FAILURE;
+        }
+        if (nfiles == 0)
+            tokenize_fd(STDIN_FILENO, sketch_word, &s);
+        for (int i = 0; i < nfiles; ++i)
+            tokenize_file(files[i], sketch_word, &s);
+    }
+    int status = save && sketch_save(&s, save) != 0 ? EXIT_FAILURE : 0;
+    sketch_print(&s, stdout);
+    sketch_free(&s);
+    return status;
+}
+
+/* ---------- Persistent count store ---------- */
+
+#define STORE_MAGIC "WCSTORE1"
+
+struct store_header {        // a store file: this, then nwords records in word order
+    char magic[8];
+    uint64_t nwords, total;  // distinct words, and the sum of their counts
+};
+// A record is: varint bytes shared with the previous word, varint length of the rest,
+// the rest of the word, varint count. Varints are 7 bits per byte, low bits first.
+
+static size_t put_varint(uint8_t *p, uint64_t v) {
+    size_t n = 0;
+    for (; v >= 0x80; v >>= 7) p[n++] = (uint8_t)v | 0x80;
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static int get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v) {
+    uint64_t x = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t b = *(*p)++;
+        x |= (uint64_t)(b & 0x7f) << shift;
+        if (b < 0x80) {
+            *v = x;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+struct store_reader {        // reads a store through mmap(), one record at a time
+    void *map;
+    size_t map_len;
+    const uint8_t *p, *end;
+    struct store_header hd;
+    uint64_t left;           // records not read yet
+    char *word;              // the current word, NUL-terminated
+    size_t len, cap;
+    uint64_t count;
+};
+
+// Opens a store. Returns 0, or -1 with a message (errno is ENOENT if there is no file).
+int store_open(struct store_reader *r, const char *path) {
+    struct stat st;
+    memset(r, 0, sizeof(*r));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct store_header)) {
+        fprintf(stderr, "[Error] %s: not a word count store\n", path);
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    r->map_len = st.st_size;
+    r->map = mmap(NULL, r->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (r->map == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    madvise(r->map, r->map_len, MADV_SEQUENTIAL);
+    memcpy(&r->hd, r->map, sizeof(r->hd));
+    if (memcmp(r->hd.magic, STORE_MAGIC, 8) != 0) {
+        fprintf(stderr, "[Error] %s: not a word count store\n", path);
+        munmap(r->map, r->map_len);
+        errno = EINVAL;
+        return -1;
+    }
+    r->p = (const uint8_t *)r->map + sizeof(r->hd);
+    r->end = (const uint8_t *)r->map + r->map_len;
+    r->left = r->hd.nwords;
+    return 0;
+}
+
+// Reads the next record into r->word, r->len and r->count. Returns 1, 0 at the end,
+// or -1 if the file is damaged.
+int store_next(struct store_reader *r) {
+    uint64_t shared, rest;
+    if (r->left == 0) return 0;
+    if (get_varint(&r->p, r->end, &shared) != 0 || get_varint(&r->p, r->end, &rest) != 0 || shared > r->len
+        || rest > (uint64_t)(r->end - r->p))
+        return -1;
+    if (shared + rest + 1 > r->cap) {
+        r->cap = (shared + rest + 1) * 2;
+        if ((r->word = (char *)realloc(r->word, r->cap)) == NULL) return -1;
+    }
+    memcpy(r->word + shared, r->p, rest);
+    r->p += rest;
+    r->len = shared + rest;
+    r->word[r->len] = '\0';
+    if (get_varint(&r->p, r->end, &r->count) != 0) return -1;
+    r->left--;
+    return 1;
+}
+
+void store_close(struct store_reader *r) {
+    if (r->map) munmap(r->map, r->map_len);
+    free(r->word);
+    memset(r, 0, sizeof(*r));
+}
+
+struct store_writer {
+    FILE *f;
+    struct store_header hd;
+    char *prev;              // the last word written, for prefix compression
+    size_t prevlen, cap;
+};
+
+int store_create(struct store_writer *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+    memcpy(w->hd.magic, STORE_MAGIC, 8);
+    if ((w->f = fopen(path, "wb")) == NULL) {
+        perror(path);
+        return -1;
+    }
+    setvbuf(w->f, NULL, _IOFBF, 1 << 20);
+    return fwrite(&w->hd, sizeof(w->hd), 1, w->f) == 1 ? 0 : -1;   // rewritten by store_finish()
+}
+
+// Appends a record; words must come in increasing order
+int store_put(struct store_writer *w, const char *word, size_t len, uint64_t count) {
+    uint8_t head[30];
+    size_t shared = 0, n;
+    while (shared < len && shared < w->prevlen && word[shared] == w->prev[shared]) shared++;
+    n = put_varint(head, shared);
+    n += put_varint(head + n, len - shared);
+    if (fwrite(head, 1, n, w->f) != n || fwrite(word + shared, 1, len - shared, w->f) != len - shared) return -1;
+    n = put_varint(head, count);
+    if (fwrite(head, 1, n, w->f) != n) return -1;
+    if (len > w->cap) {
+        w->cap = len * 2;
+        if ((w->prev = (char *)realloc(w->prev, w->cap)) == NULL) return -1;
+    }
+    memcpy(w->prev + shared, word + shared, len - shared);
+    w->prevlen = len;
+    w->hd.nwords++;
+    w->hd.total += count;
+    return 0;
+}
+
+int store_finish(struct store_writer *w) {
+    int ok = fseek(w->f, 0, SEEK_SET) == 0 && fwrite(&w->hd, sizeof(w->hd), 1, w->f) == 1;
+    if (fclose(w->f) != 0) ok = 0;
+    free(w->prev);
+    return ok ? 0 : -1;
+}
+
+// Compares two words by their bytes, like strcmp(), with explicit lengths
+static int wordncmp(const char *a, size_t alen, const char *b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    return c ? c : (alen > blen) - (alen < blen);
+}
+
+// Merges the counts e[0..n) (in word order) into the store at path, creating it if needed.
+// One streaming pass over the old file and the new records writes path.tmp, which then
+// replaces the old file, so the time is the old file's size plus the new input.
+int store_update(const char *path, const struct entry *e, size_t n) {
+    struct store_reader r;
+    struct store_writer w;
+    size_t tmplen = strlen(path) + 5, i = 0;
+    char *tmp = (char *)malloc(tmplen);
+    int have = 0, err = 0;
+    if (tmp == NULL) return -1;
+    snprintf(tmp, tmplen, "%s.tmp", path);
+    if (store_open(&r, path) == 0) {
+        have = 1;
+    } else if (errno != ENOENT) {
+        free(tmp);
+        return -1;
+    }
+    if (store_create(&w, tmp) != 0) {
+        if (have) store_close(&r);
+        free(tmp);
+        return -1;
+    }
+    int more = have ? store_next(&r) : 0;
+    while (!err && (more == 1 || i < n)) {
+        int c = more != 1 ? 1 : i == n ? -1 : wordncmp(r.word, r.len, e[i].word, strlen(e[i].word));
+        if (c < 0) {
+            err = store_put(&w, r.word, r.len, r.count);
+            more = store_next(&r);
+        } else if (c > 0) {
+            err = store_put(&w, e[i].word, strlen(e[i].word), (uint64_t)e[i].count);
+            i++;
+        } else {
+            err = store_put(&w, r.word, r.len, r.count + (uint64_t)e[i].count);
+            more = store_next(&r);
+            i++;
+        }
+    }
+    if (more < 0) {
+        fprintf(stderr, "[Error] %s: store is damaged, left unchanged\n", path);
+        err = -1;
+    }
+    if (store_finish(&w) != 0) err = -1;
+    if (have) store_close(&r);
+    if (err == 0 && rename(tmp, path) != 0) {
+        perror(path);
+        err = -1;
+    }
+    if (err != 0) unlink(tmp);
+    free(tmp);
+    return err ? -1 : 0;
+}
+
+// Prints a store like print_counts() prints a tree
+int store_show(const char *path, FILE *out) {
+    struct store_reader r;
+    struct entry *e = NULL;
+    size_t n = 0;
+    int more;
+    if (store_open(&r, path) != 0) {
+        if (errno == ENOENT) perror(path);
+        return -1;
+    }
+    if (top_k) {
+        // A K-entry heap of copies; a word is copied only when it gets in
+        if ((e = (struct entry *)malloc(top_k * sizeof(*e))) == NULL) more = -1;
+        while (e && (more = store_next(&r)) == 1) {
+            struct entry cand = {r.word, (long)r.count};
+            if (n == top_k && cmp_rank(&cand, &e[0]) >= 0) continue;
+            if ((cand.word = strdup(r.word)) == NULL) break;
+            if (n == top_k) free(e[0].word);
+            topk_offer(e, &n, top_k, cand);
+        }
+        if (more == 0) {
+            qsort(e, n, sizeof(*e), cmp_rank);
+            print_records(e, n, out);
+        }
+        for (size_t i = 0; i < n; ++i) free(e[i].word);
+    } else if (order_count) {
+        // Every word in one block: the file says how many there are
+        char *words = NULL, *at;
+        size_t bytes = 0;
+        while ((more = store_next(&r)) == 1) bytes += r.len + 1;
+        const uint8_t *first = (const uint8_t *)r.map + sizeof(r.hd);
+        e = (struct entry *)malloc((r.hd.nwords ? r.hd.nwords : 1) * sizeof(*e));
+        at = words = (char *)malloc(bytes ? bytes : 1);
+        if (more == 0 && e && words) {
+            r.p = first;
+            r.left = r.hd.nwords;
+            r.len = 0;
+            while ((more = store_next(&r)) == 1) {
+                memcpy(at, r.word, r.len + 1);
+                e[n++] = (struct entry){at, (long)r.count};
+                at += r.len + 1;
+            }
+            if (more == 0 && sort_by_count(e, n) != 0) qsort(e, n, sizeof(*e), cmp_rank);
+            if (more == 0) print_records(e, n, out);
+        }
+        free(words);
+    } else {
+        while ((more = store_next(&r)) == 1)
+            fprintf(out, "%4llu %s\n", (unsigned long long)r.count, r.word);
+    }
+    free(e);
+    store_close(&r);
+    if (more != 0) fprintf(stderr, "[Error] %s: store is damaged\n", path);
+    return more == 0 ? 0 : -1;
+}
+
+// --store: counts FILEs (or stdin) and merges the counts into the store at path. The
+// step-by-step trace stays off; without -q, a summary line is printed.
+int run_store(int nfiles, char **files, const char *path) {
+    TNode *root = NULL;
+    size_t n;
+    int verbose = trace;
+    trace = 0;
+    if (nfiles == 0)
+        tokenize_fd(STDIN_FILENO, count_word, &root);
+    for (int i = 0; i < nfiles; ++i)
+        tokenize_file(files[i], count_word, &root);
+    struct entry *e = tree_records(root, &n);
+    int err = store_update(path, e, n);
+    free(e);
+    treefree(root);
+    if (err == 0 && verbose) {
+        struct store_reader r;
+        if (store_open(&r, path) == 0) {
+            printf("[Store] %s: %llu words, %llu distinct, %zu bytes\n", path, (unsigned long long)r.hd.total,
+                   (unsigned long long)r.hd.nwords, r.map_len);
+            store_close(&r);
+        }
+    }
+    return err ? EXIT_FAILURE : 0;
+}
+
+// The original unbalanced insert (as a loop, so sorted input cannot overflow the stack)
+static TNode *plain_insert(TNode *root, const char *w, int *depth) {
+    TNode **link = &root;
+    int d = 0, cond;
+    while (*link) {
+        if ((cond = strcmp(w, (*link)->word)) == 0) {
+            (*link)->count++;
+            return root;
+        }
+        link = cond < 0 ? &(*link)->left : &(*link)->right;
+        d++;
+    }
+    *link = talloc(w, strlen(w));
+    if (d + 1 > *depth) *depth = d + 1;
+    return root;
+}
+
+// Writes word i of an input kind: 0 = sorted, 1 = reverse-sorted, 2 = natural text.
+// Natural text draws from a 1M-word vocabulary with Zipf's law (rank r has weight 1/r),
+// like real prose: a few words are very common and most are rare.
+static void bench_word(int kind, size_t i, size_t n, char *w, unsigned long long *rng) {
+    if (kind == 0) {
+        snprintf(w, MAXWORD, "w%010zu", i);
+    } else if (kind == 1) {
+        snprintf(w, MAXWORD, "w%010zu", n - 1 - i);
+    } else {
+        *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+        double u = (*rng >> 11) * (1.0 / 9007199254740992.0);
+        unsigned long long rank = (unsigned long long)exp(u * log(1000000.0));
+        // Scramble the rank into a pseudo-word so rank order is not alphabetical order
+        unsigned long long h = rank * 0x9E3779B97F4A7C15ull;
+        int len = 3 + (int)(h >> 61);
+        for (int k = 0; k < len; ++k, h = h * 6364136223846793005ull + 1442695040888963407ull)
+            w[k] = 'a' + (h >> 33) % 26;
+        snprintf(w + len, MAXWORD - len, "%llu", rank);
+    }
+}
+
+// Builds a tree from n words of each input kind and times insert, in-order print and free
+void run_bench(size_t n) {
+    const char *kinds[] = {"sorted", "reverse", "natural"};
+    const size_t plain_cap = 20000;  // the unbalanced tree is quadratic on sorted input
+    char w[MAXWORD];
+    FILE *devnull = fopen("/dev/null", "w");
+    if (devnull == NULL) {
+        perror("/dev/null");
+        return;
+    }
+    trace = 0;
+    printf("AVL word tree: %zu words per input\n", n);
+    printf("%-8s %10s %7s %12s %10s %10s   %s\n", "input", "distinct", "height",
+           "insert ns/w", "print s", "free s", "plain BST on first 20k words");
+    for (int kind = 0; kind < 3; ++kind) {
+        unsigned long long rng = 88172645463325252ull;
+        TNode *root = NULL;
+        double t0 = now_sec();
+        for (size_t i = 0; i < n; ++i) {
+            bench_word(kind, i, n, w, &rng);
+            root = tree(root, w);
+        }
+        double t_insert = now_sec() - t0;
+        size_t distinct = 0;
+        {
+            // Count nodes with the same explicit-stack walk treeprint uses
+            const TNode *stack[MAX_HEIGHT], *p = root;
+            int sp = 0;
+            while (p || sp) {
+                while (p) { stack[sp++] = p; p = p->left; }
+                p = stack[--sp];
+                distinct++;
+                p = p->right;
+            }
+        }
+        int h = height(root);
+        t0 = now_sec();
+        treeprint_to(root, devnull);
+        double t_print = now_sec() - t0;
+        t0 = now_sec();
+        treefree(root);
+        double t_free = now_sec() - t0;
+
+        // The old unbalanced tree, on a prefix small enough to finish
+        size_t m = n < plain_cap ? n : plain_cap;
+        int plain_depth = 0;
+        rng = 88172645463325252ull;
+        root = NULL;
+        t0 = now_sec();
+        for (size_t i = 0; i < m; ++i) {
+            bench_word(kind, i, kind == 2 ? n : m, w, &rng);
+            root = plain_insert(root, w, &plain_depth);
+        }
+        double t_plain = now_sec() - t0;
+        treefree(root);
+
+        printf("%-8s %10zu %7d %12.1f %10.3f %10.3f   %.1f ns/w, height %d\n", kinds[kind], distinct, h,
+               t_insert * 1e9 / n, t_print, t_free, t_plain * 1e9 / m, plain_depth);
+    }
+    fclose(devnull);
+}
+
+static void count_only(const char *w, size_t len, void *ctx) {
+    (void)w;
+    *(size_t *)ctx += len > 0;
+}
+
+// Scalar version of tokenize(), one byte at a time, for comparison
+static void tokenize_scalar(const char *buf, size_t len, word_fn fn, void *ctx) {
+    size_t i = 0;
+    while (i < len) {
+        while (i < len && !is_alnum((unsigned char)buf[i])) i++;
+        size_t s = i;
+        while (i < len && is_alnum((unsigned char)buf[i])) i++;
+        if (i > s) emit_run(buf + s, buf + i, fn, ctx);
+    }
+}
+
+// Writes mb megabytes of Zipf-distributed "natural" text to f
+static void write_text(FILE *f, size_t mb, unsigned long long *rng) {
+    char w[MAXWORD];
+    static const char *seps[] = {" ", " ", " ", " ", ", ", ".\n", " (", ") ", " -- ", "\n\n"};
+    for (size_t bytes = 0; bytes < mb << 20;) {
+        bench_word(2, 0, 0, w, rng);
+        w[0] &= *rng & 1 ? ~0x20 : ~0;           // some capitalized words
+        const char *sep = seps[(*rng >> 20) % 10];
+        bytes += fprintf(f, "%s%s", w, sep);
+    }
+}
+
+// Writes mb megabytes of text to a new temporary file
+static int make_text_file(char *path, size_t mb) {
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return -1;
+    }
+    FILE *f = fdopen(fd, "w");
+    unsigned long long rng = 88172645463325252ull;
+    write_text(f, mb, &rng);
+    fclose(f);
+    return 0;
+}
+
+// Times getword(), the scalar loop and the 64-byte-block tokenizer on the same text
+void run_token_bench(size_t mb) {
+    char path[] = "/tmp/wordcount_benchXXXXXX";
+    if (make_text_file(path, mb) != 0) return;
+    int fd;
+
+    printf("Tokenizer: %zu MB of text\n", mb);
+    printf("%-28s %10s %10s\n", "method", "words", "MB/s");
+    char word[MAXWORD];
+    size_t words = 0;
+    double t0 = now_sec();
+    if (freopen(path, "r", stdin) == NULL) {
+        perror(path);
+        unlink(path);
+        return;
+    }
+    while (getword(word, MAXWORD) != EOF)
+        words += isalpha((unsigned char)word[0]) != 0;
+    double t = now_sec() - t0;
+    printf("%-28s %10zu %10.1f\n", "getword() (getchar/ungetc)", words, mb / t);
+
+    fd = open(path, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    char *text = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    for (int simd = 0; simd < 2; ++simd) {
+        words = 0;
+        t0 = now_sec();
+        if (simd) tokenize(text, st.st_size, count_only, &words);
+        else tokenize_scalar(text, st.st_size, count_only, &words);
+        t = now_sec() - t0;
+        printf("%-28s %10zu %10.1f\n", simd ? "tokenize() 64-byte masks" : "byte-at-a-time loop", words, mb / t);
+    }
+    // Memory bandwidth reference: just reading every byte
+    uint64_t sum = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i + 8 <= (size_t)st.st_size; i += 8) {
+        uint64_t v;
+        memcpy(&v, text + i, 8);
+        sum += v;
+    }
+    t = now_sec() - t0;
+    printf("%-28s %10s %10.1f   (checksum %llx)\n", "reading 8 bytes per step", "-", mb / t, (unsigned long long)sum & 0xff);
+    munmap(text, st.st_size);
+    unlink(path);
+}
+
+// Builds a tree of n distinct words with skewed counts, keeping the top 100 online or not
+static TNode *build_counted(size_t n, int online, double *secs) {
+    unsigned long long rng = 88172645463325252ull;
+    char w[MAXWORD];
+    TNode *root = NULL;
+    if (online) top_start(100);
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        int len = snprintf(w, sizeof(w), "w%010llu", (rng >> 16) % (n * 4));
+        int count = (rng & 1023) == 0 ? (int)(rng >> 44) % 100000 + 1 : (int)(rng >> 40) % 16 + 1;
+        root = tree_add(root, w, len, count);
+    }
+    *secs = now_sec() - t0;
+    return root;
+}
+
+// Times the three output orders on a tree of n words (most of them distinct)
+void run_output_bench(size_t n) {
+    FILE *devnull = fopen("/dev/null", "w");
+    double t_build, t_online, t0;
+    size_t k;
+    if (devnull == NULL) {
+        perror("/dev/null");
+        return;
+    }
+    trace = 0;
+    // The online build goes first: a build into memory freed by an earlier tree is slower
+    TNode *root = build_counted(n, 1, &t_online);
+    printf("Output benchmark: %zu insertions, skewed counts\n", n);
+    printf("%-36s %12s\n", "output", "seconds");
+    t0 = now_sec();
+    print_counts(root, devnull);
+    printf("%-36s %12.6f\n", "--top 100, heap kept while counting", now_sec() - t0);
+    struct entry *kept = (struct entry *)malloc(100 * sizeof(*kept));
+    for (k = 0; kept && k < top_n; ++k) kept[k] = (struct entry){top_heap[k]->word, top_heap[k]->count};
+    top_stop();
+
+    t0 = now_sec();
+    treeprint_to(root, devnull);
+    printf("%-36s %12.4f\n", "alphabetical (treeprint)", now_sec() - t0);
+    t0 = now_sec();
+    order_count = 1;
+    print_counts(root, devnull);
+    order_count = 0;
+    printf("%-36s %12.4f\n", "--sort-count (flat array, radix)", now_sec() - t0);
+    t0 = now_sec();
+    top_k = 100;
+    print_counts(root, devnull);
+    top_k = 0;
+    printf("%-36s %12.4f\n", "top 100, walking the tree", now_sec() - t0);
+
+    // The online heap must hold exactly the words a full walk finds
+    size_t nwalked;
+    struct entry *walked = tree_top(root, 100, &nwalked);
+    int same = kept && walked && nwalked == k;
+    if (same) {
+        qsort(kept, k, sizeof(*kept), cmp_rank);
+        qsort(walked, k, sizeof(*walked), cmp_rank);
+    }
+    for (size_t i = 0; same && i < k; ++i)
+        same = walked[i].count == kept[i].count && strcmp(walked[i].word, kept[i].word) == 0;
+    printf("online top 100 %s the walked top 100\n", same ? "matches" : "DIFFERS FROM");
+    free(kept);
+    free(walked);
+    treefree(root);
+
+    treefree(build_counted(n, 0, &t_build));
+    printf("counting: %.3f s with the online heap, %.3f s without it\n", t_online, t_build);
+    fclose(devnull);
+}
+
+// FNV-1a over the output, to check every thread count prints the same thing
+static uint64_t fnv1a(uint64_t h, const char *p, size_t n) {
+    for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)p[i]) * 0x100000001b3ull;
+    return h;
+}
+
+// Counts the same text with 1, 2, 4, ... max_threads threads
+void run_thread_bench(size_t mb, int max_threads) {
+    char path[] = "/tmp/wordcount_benchXXXXXX";
+    if (max_threads < 1 || max_threads > MAX_THREADS || make_text_file(path, mb) != 0) return;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    char *text = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    trace = 0;
+    printf("Parallel word count: %zu MB of text, %ld CPUs\n", mb, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s %10s %10s %10s %9s %10s\n", "threads", "count s", "merge s", "total s", "speedup", "words");
+    double base = 0;
+    uint64_t want = 0;
+    for (int nt = 1; nt <= max_threads; nt *= 2) {
+        struct span *spans = NULL;
+        int nspans = 0, cap = 0;
+        double tc, tm;
+        add_spans(text, st.st_size, nt * 4, &spans, &nspans, &cap);
+        struct merge_job *jobs = count_parallel(spans, nspans, nt, &tc, &tm);
+        uint64_t h = 0xcbf29ce484222325ull;
+        size_t lines = 0;
+        for (int t = 0; t < nt; ++t) {
+            h = fnv1a(h, jobs[t].out, jobs[t].len);
+            for (size_t i = 0; i < jobs[t].len; ++i) lines += jobs[t].out[i] == '\n';
+        }
+        if (nt == 1) {
+            base = tc + tm;
+            want = h;
+        }
+        printf("%8d %10.3f %10.3f %10.3f %8.2fx %10zu%s\n", nt, tc, tm, tc + tm, base / (tc + tm), lines,
+               h == want ? "" : "  [Error] output differs from 1 thread");
+        free_jobs(jobs, nt);
+        free(spans);
+    }
+    munmap(text, st.st_size);
+    unlink(path);
+}
+
+// Writes a URL-like key: a few thousand hosts and Zipf-distributed path segments, so
+// keys are long and share long prefixes
+static void url_word(unsigned long long *rng, char *w) {
+    char seg[MAXWORD];
+    *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+    unsigned long long r = *rng;
+    int len = snprintf(w, MAXWORD, "https://www.site%llu.%s/", (r >> 8) % 3000 * ((r >> 20) % 3 + 1) % 3000,
+                       (r & 3) == 0 ? "org" : "com");
+    for (int k = 0; k < 1 + (int)((r >> 40) & 3) && len < MAXWORD - 1; ++k) {
+        bench_word(2, 0, 0, seg, rng);
+        len += snprintf(w + len, MAXWORD - len, "%s%s", k ? "/" : "", seg);
+    }
+    if ((r >> 50 & 1) && len < MAXWORD - 1) snprintf(w + len, MAXWORD - len, "?id=%llu", (r >> 51) % 100000);
+}
+
+// Bytes glibc's malloc really uses for a request (8-byte header, 16-byte steps, 32 minimum)
+static size_t chunk_bytes(size_t request) {
+    size_t c = (request + 8 + 15) & ~(size_t)15;
+    return c < 32 ? 32 : c;
+}
+
+struct index_stats {
+    size_t bytes, leaves, depth_sum;
+    uint64_t hash;           // FNV-1a over "count word" in order, to compare the indexes
+};
+
+static void art_stats_leaf(ArtLeaf *leaf, int depth, void *ctx) {
+    struct index_stats *st = (struct index_stats *)ctx;
+    char line[32];
+    st->bytes += chunk_bytes(sizeof(ArtLeaf) + leaf->len + 1);
+    st->leaves++;
+    st->depth_sum += depth + 1;             // the nodes on the way, and the leaf
+    st->hash = fnv1a(st->hash, line, snprintf(line, sizeof(line), "%d ", leaf->count));
+    st->hash = fnv1a(st->hash, leaf->word, leaf->len);
+}
+
+static void art_stats_node(ArtNode *node, void *ctx) {
+    static const size_t size[] = {sizeof(ArtNode4), sizeof(ArtNode16), sizeof(ArtNode48), sizeof(ArtNode256)};
+    ((struct index_stats *)ctx)->bytes += chunk_bytes(size[node->type]);
+}
+
+// The same for the AVL tree: a preorder walk with the depth of every node
+static void tree_stats(const TNode *root, struct index_stats *st) {
+    struct node_depth { const TNode *p; int depth; } stack[MAX_HEIGHT + 1];
+    int sp = 0;
+    size_t n;
+    if (root) stack[sp++] = (struct node_depth){root, 1};
+    while (sp > 0) {
+        const TNode *p = stack[--sp].p;
+        int depth = stack[sp].depth;
+        st->bytes += chunk_bytes(sizeof(TNode)) + chunk_bytes(strlen(p->word) + 1);
+        st->leaves++;
+        st->depth_sum += depth;
+        if (p->right) stack[sp++] = (struct node_depth){p->right, depth + 1};
+        if (p->left) stack[sp++] = (struct node_depth){p->left, depth + 1};
+    }
+    struct entry *e = tree_records(root, &n);
+    for (size_t i = 0; i < n; ++i) {
+        char line[32];
+        st->hash = fnv1a(st->hash, line, snprintf(line, sizeof(line), "%ld ", e[i].count));
+        st->hash = fnv1a(st->hash, e[i].word, strlen(e[i].word));
+    }
+    free(e);
+}
+
+// Counts n natural-text words, then n URL-like keys, in the AVL tree and the radix tree
+void run_index_bench(size_t n) {
+    static const char *corpus[] = {"natural text", "URL-like"};
+    FILE *devnull = fopen("/dev/null", "w");
+    char w[MAXWORD];
+    if (devnull == NULL) {
+        perror("/dev/null");
+        return;
+    }
+    trace = 0;
+    printf("Word index benchmark: %zu keys per corpus\n", n);
+    printf("%-13s %-6s %10s %9s %9s %10s %11s %10s\n", "corpus", "index", "distinct", "insert s", "print s",
+           "ns/insert", "bytes/word", "avg depth");
+    for (int c = 0; c < 2; ++c) {
+        struct index_stats avl = {0, 0, 0, 0xcbf29ce484222325ull}, art = avl;
+        unsigned long long rng = 88172645463325252ull;
+        double t0 = now_sec(), t_ins, t_out;
+        TNode *root = NULL;
+        for (size_t i = 0; i < n; ++i) {
+            if (c == 0) bench_word(2, i, n, w, &rng);
+            else url_word(&rng, w);
+            root = tree_add(root, w, strlen(w), 1);
+        }
+        t_ins = now_sec() - t0;
+        t0 = now_sec();
+        treeprint_to(root, devnull);
+        t_out = now_sec() - t0;
+        tree_stats(root, &avl);
+        printf("%-13s %-6s %10zu %9.2f %9.2f %10.0f %11.1f %10.2f\n", corpus[c], "AVL", avl.leaves, t_ins, t_out,
+               t_ins * 1e9 / n, (double)avl.bytes / avl.leaves, (double)avl.depth_sum / avl.leaves);
+        treefree(root);
+
+        rng = 88172645463325252ull;
+        Art t = {NULL, 0};
+        t0 = now_sec();
+        for (size_t i = 0; i < n; ++i) {
+            if (c == 0) bench_word(2, i, n, w, &rng);
+            else url_word(&rng, w);
+            art_add(&t, w, strlen(w), 1);
+        }
+        t_ins = now_sec() - t0;
+        t0 = now_sec();
+        art_print(&t, devnull);
+        t_out = now_sec() - t0;
+        art_walk(&t, art_stats_leaf, art_stats_node, &art);
+        printf("%-13s %-6s %10zu %9.2f %9.2f %10.0f %11.1f %10.2f%s\n", "", "ART", art.leaves, t_ins, t_out,
+               t_ins * 1e9 / n, (double)art.bytes / art.leaves, (double)art.depth_sum / art.leaves,
+               art.hash == avl.hash ? "" : "  [Error] counts differ from the AVL tree");
+        art_free(&t);
+    }
+    printf("\nInsert times include generating the keys. bytes/word counts malloc chunks; avg depth is\n"
+           "the nodes a lookup visits (each one a likely cache miss).\n");
+    fclose(devnull);
+}
+
+// FNV-1a over the records of a tree or a store, to check they hold the same counts
+static uint64_t records_hash(uint64_t h, const char *word, long count) {
+    char line[32];
+    h = fnv1a(h, line, snprintf(line, sizeof(line), "%ld ", count));
+    return fnv1a(h, word, strlen(word));
+}
+
+// Simulates days of logs: each day, recounting all text so far vs counting only the new
+// day and merging it into a store
+void run_store_bench(int days, size_t mb) {
+    char path[] = "/tmp/wordcount_storeXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return;
+    }
+    close(fd);
+    unlink(path);                           // the first update creates it
+    trace = 0;
+    unsigned long long rng = 88172645463325252ull;
+    char *history = NULL;
+    size_t hlen = 0, n;
+    printf("Incremental counting: %d days of %zu MB\n", days, mb);
+    printf("%4s %11s %11s %14s %10s %12s %9s\n", "day", "history MB", "recount s", "count+merge s", "store MB",
+           "distinct", "B/word");
+    TNode *all = NULL;
+    for (int d = 1; d <= days; ++d) {
+        char *day = NULL;
+        size_t dlen = 0;
+        FILE *f = open_memstream(&day, &dlen);
+        if (f == NULL) break;
+        write_text(f, mb, &rng);
+        fclose(f);
+        char *grown = (char *)realloc(history, hlen + dlen);
+        if (grown == NULL) {
+            free(day);
+            break;
+        }
+        history = grown;
+        memcpy(history + hlen, day, dlen);
+        hlen += dlen;
+
+        treefree(all);
+        all = NULL;
+        double t0 = now_sec();
+        tokenize(history, hlen, count_word, &all);
+        double t_recount = now_sec() - t0;
+
+        t0 = now_sec();
+        TNode *root = NULL;
+        tokenize(day, dlen, count_word, &root);
+        struct entry *e = tree_records(root, &n);
+        int err = store_update(path, e, n);
+        double t_incr = now_sec() - t0;
+        free(e);
+        treefree(root);
+        free(day);
+
+        struct store_reader r;
+        if (err != 0 || store_open(&r, path) != 0) break;
+        printf("%4d %11.0f %11.3f %14.3f %10.2f %12llu %9.2f\n", d, hlen / 1048576.0, t_recount, t_incr,
+               r.map_len / 1048576.0, (unsigned long long)r.hd.nwords, (double)r.map_len / r.hd.nwords);
+        store_close(&r);
+    }
+
+    // The store must now hold exactly what recounting everything gives
+    struct store_reader r;
+    uint64_t want = 0xcbf29ce484222325ull, got = want;
+    struct entry *e = tree_records(all, &n);
+    for (size_t i = 0; i < n; ++i) want = records_hash(want, e[i].word, e[i].count);
+    if (store_open(&r, path) == 0) {
+        while (store_next(&r) == 1) got = records_hash(got, r.word, (long)r.count);
+        store_close(&r);
+    }
+    printf("store %s a full recount of the history\n", got == want ? "matches" : "DIFFERS FROM");
+    free(e);
+    treefree(all);
+    free(history);
+    unlink(path);
+}
+
+// Compares a sketch's estimates against exact counts for every distinct word
+static void sketch_report(const char *label, const struct sketch *s, const struct entry *rec, size_t n,
+                          const struct entry *top, size_t ntop, double secs) {
+    double bound = exp(1.0) / s->width * s->total, sum = 0;
+    uint32_t worst = 0;
+    size_t within = 0, found = 0, under = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t est = cms_estimate(s, word_hash(rec[i].word, strlen(rec[i].word)));
+        if (est < rec[i].count) {
+            under++;
+            continue;
+        }
+        uint32_t err = est - (uint32_t)rec[i].count;
+        sum += err;
+        if (err > worst) worst = err;
+        within += err <= bound;
+    }
+    for (size_t i = 0; i < ntop; ++i) {
+        uint64_t h = word_hash(top[i].word, strlen(top[i].word));
+        for (size_t j = 0; j < s->n; ++j) found += s->hash[j] == h;
+    }
+    double distinct = hll_estimate(s);
+    printf("%-22s %10zu %8.2f %10.2f %8u %9.0f %8.3f%% %7.2f%% %5zu/%zu%s\n", label, sketch_bytes(s), secs,
+           sum / n, worst, bound, 100.0 * within / n, 100.0 * (distinct - n) / n, found, ntop,
+           under ? "  [Error] some estimates are too low" : "");
+}
+
+// Splits text at a word boundary near the middle
+static size_t text_middle(const char *text, size_t len) {
+    size_t mid = len / 2;
+    while (mid < len && isalnum((unsigned char)text[mid])) mid++;
+    return mid;
+}
+
+// Counts the same text exactly and with --approx sketches of several budgets
+void run_sketch_bench(size_t mb, size_t budget) {
+    char path[] = "/tmp/wordcount_benchXXXXXX";
+    char save_a[] = "/tmp/wordcount_sketchXXXXXX", save_b[] = "/tmp/wordcount_sketchXXXXXX";
+    if (make_text_file(path, mb) != 0) return;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    char *text = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    trace = 0;
+
+    double t0 = now_sec();
+    TNode *root = NULL;
+    tokenize(text, st.st_size, count_word, &root);
+    double t_exact = now_sec() - t0;
+    size_t n, ntop;
+    struct entry *rec = tree_records(root, &n);
+    struct entry *top = tree_top(root, 100, &ntop);
+    size_t exact_bytes = 0;
+    for (size_t i = 0; i < n; ++i) exact_bytes += sizeof(TNode) + strlen(rec[i].word) + 1;
+    printf("Approximate counting: %zu MB of text, %zu distinct words\n", mb, n);
+    printf("exact tree: %.2f s, %zu bytes of nodes and words (before malloc overhead)\n\n", t_exact, exact_bytes);
+    printf("%-22s %10s %8s %10s %8s %9s %9s %8s %9s\n", "sketch (--top 100)", "bytes", "seconds", "mean over",
+           "max over", "bound", "in bound", "distinct", "top 100");
+
+    size_t budgets[3] = {budget / 4, budget, budget * 4};
+    for (int b = 0; b < 3; ++b) {
+        struct sketch s, half;
+        char label[64];
+        if (sketch_init(&s, budgets[b], 100) != 0) {
+            printf("%zu bytes: too small for 100 heavy hitters\n", budgets[b]);
+            continue;
+        }
+        t0 = now_sec();
+        tokenize(text, st.st_size, sketch_word, &s);
+        snprintf(label, sizeof(label), "--approx %zuk", budgets[b] >> 10);
+        sketch_report(label, &s, rec, n, top, ntop, now_sec() - t0);
+
+        // The same text as two shards, saved and merged back
+        size_t mid = text_middle(text, st.st_size);
+        int fa = mkstemp(save_a), fb = mkstemp(save_b);
+        close(fa);
+        close(fb);
+        t0 = now_sec();
+        sketch_free(&s);
+        sketch_init(&s, budgets[b], 100);
+        tokenize(text, mid, sketch_word, &s);
+        sketch_init(&half, budgets[b], 100);
+        tokenize(text + mid, st.st_size - mid, sketch_word, &half);
+        int ok = sketch_save(&s, save_a) == 0 && sketch_save(&half, save_b) == 0;
+        sketch_free(&s);
+        sketch_free(&half);
+        ok = ok && sketch_load(&s, save_a) == 0;
+        ok = ok && sketch_load(&half, save_b) == 0 && sketch_merge(&s, &half) == 0;
+        if (ok) {
+            snprintf(label, sizeof(label), "  2 shards merged");
+            sketch_report(label, &s, rec, n, top, ntop, now_sec() - t0);
+            sketch_free(&half);
+        }
+        sketch_free(&s);
+        unlink(save_a);
+        unlink(save_b);
+        strcpy(save_a, "/tmp/wordcount_sketchXXXXXX");
+        strcpy(save_b, "/tmp/wordcount_sketchXXXXXX");
+    }
+    printf("\nmean/max over: how much estimates exceed the exact counts; bound: e/width * words,\n"
+           "which each estimate should stay under with 98%% probability; distinct: HyperLogLog error.\n");
+    free(rec);
+    free(top);
+    treefree(root);
+    munmap(text, st.st_size);
+    unlink(path);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-tokens") == 0) {
+        run_token_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 256);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-output") == 0) {
+        run_output_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-store") == 0) {
+        run_store_bench(argc > 2 ? atoi(argv[2]) : 10, argc > 3 ? strtoul(argv[3], NULL, 10) : 32);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-index") == 0) {
+        run_index_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-sketch") == 0) {
+        run_sketch_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 128, argc > 3 ? parse_size(argv[3]) : 1 << 20);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-threads") == 0) {
+        run_thread_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 1024, argc > 3 ? atoi(argv[3]) : 64);
+        return 0;
+    }
+    int first = 1, nthreads = 0, merge = 0;
+    size_t budget = 0;
+    const char *save = NULL, *store = NULL, *show = NULL;
+    for (; first < argc; ++first) {
+        if (strcmp(argv[first], "-q") == 0) {
+            trace = 0;
+        } else if (strcmp(argv[first], "--approx") == 0 && first + 1 < argc) {
+            if ((budget = parse_size(argv[++first])) == 0) {
+                fprintf(stderr, "[Error] --approx takes a memory budget, like 64M\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[first], "--save") == 0 && first + 1 < argc) {
+            save = argv[++first];
+        } else if (strcmp(argv[first], "--merge") == 0) {
+            merge = 1;
+        } else if (strcmp(argv[first], "--top") == 0 && first + 1 < argc) {
+            top_k = strtoul(argv[++first], NULL, 10);
+            if (top_k == 0) {
+                fprintf(stderr, "[Error] --top takes a count of at least 1\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[first], "--store") == 0 && first + 1 < argc) {
+            store = argv[++first];
+        } else if (strcmp(argv[first], "--show") == 0 && first + 1 < argc) {
+            show = argv[++first];
+        } else if (strcmp(argv[first], "--art") == 0) {
+            use_art = 1;
+        } else if (strcmp(argv[first], "--sort-count") == 0) {
+            order_count = 1;
+        } else if (strcmp(argv[first], "-j") == 0 && first + 1 < argc) {
+            nthreads = atoi(argv[++first]);
+            if (nthreads < 1 || nthreads > MAX_THREADS) {
+                fprintf(stderr, "[Error] -j takes 1 to %d threads\n", MAX_THREADS);
+                return EXIT_FAILURE;
+            }
+        } else {
+            break;
+        }
+    }
+    if ((store || show) && (nthreads > 0 || budget > 0 || merge || use_art || save || (store && show))) {
+        fprintf(stderr, "[Error] --store and --show work on their own (with -q, --top or --sort-count)\n");
+        return EXIT_FAILURE;
+    }
+    if (show) {
+        if (first < argc) {
+            fprintf(stderr, "[Error] --show reads only the store\n");
+            return EXIT_FAILURE;
+        }
+        return store_show(show, stdout) == 0 ? 0 : EXIT_FAILURE;
+    }
+    if (store) return run_store(argc - first, argv + first, store);
+    if (use_art && (nthreads > 0 || budget > 0 || merge)) {
+        fprintf(stderr, "[Error] --art counts single-threaded and exactly\n");
+        return EXIT_FAILURE;
+    }
+    if (budget > 0 || merge) {
+        if (nthreads > 0 || order_count) {
+            fprintf(stderr, "[Error] --approx and --merge print heavy hitters only, single-threaded\n");
+            return EXIT_FAILURE;
+        }
+        return run_approx(argc - first, argv + first, budget, save, merge);
+    }
+    if (save) {
+        fprintf(stderr, "[Error] --save needs --approx or --merge\n");
+        return EXIT_FAILURE;
+    }
+    if (nthreads > 0) {
+        trace = 0;
+        return run_parallel(argc - first, argv + first, nthreads);
+    }
+    if (top_k && !use_art) top_start(top_k);
+    run_demo(argc - first, argv + first);
+    top_stop();
     return 0;
 }
 
@@ -135,5 +2774,17 @@ Tutorial Notes:
 - Each node contains a word, count, and left/right children.
 - Words are inserted in order; duplicates increment the count.
 - The tree is printed in sorted order (in-order traversal).
-- This is a classic recursive data structure in C.
+- This is a classic recursive data structure in C; here the recursion is replaced by
+  loops and a small explicit stack, so input size cannot overflow the call stack.
+- AVL rotations keep the tree about log2(n) deep, whatever order the words arrive in.
+- mmap() plus 64-byte bit masks find word boundaries without a function call per byte.
+- Private per-thread trees need no locks; sorted results combine with a k-way merge,
+  and splitting the merge by word range lets every thread take part in it too.
+- A bounded min-heap finds the top K of n items in O(n log K) time and O(K) memory;
+  when the items only ever grow, the heap can even be kept current as they change.
+- A radix tree's depth depends on the key length, not the number of keys; adaptive
+  node sizes and path compression keep it small and shallow.
+- Sorted data merges in one streaming pass; sorted words also prefix-compress well.
+- Sketches trade exact answers for fixed memory: Count-Min for frequencies, HyperLogLog
+  for the number of distinct items. Both merge by combining their arrays.
 */
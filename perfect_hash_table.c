@@ -0,0 +1,629 @@
+/*
+ * perfect_hash_table.c
+ *
+ * Andrew M's Tutorial: A Prebuilt, Memory-Mapped Perfect Hash Table in C
+ *
+ * hash_table_lookup.c builds its table at run time: every start calls install() once
+ * per pair. With hundreds of thousands of macros that startup cost adds up, and it is
+ * paid again on every run even though the table never changes.
+ *
+ * This program splits the work in two:
+ *
+ *   build   (offline, once)  reads "NAME DEF" lines and writes a read-only file holding
+ *                            a minimal perfect hash function plus the packed strings.
+ *   lookup  (every run)      mmap()s the file and answers queries straight from it:
+ *                            no parsing, no allocation, no install() calls. Opening
+ *                            takes the same few microseconds for 100 keys or 10 million.
+ *
+ * The perfect hash ("hash, displace and compress", CHD):
+ *   - Every key hashes to 64 bits. The high bits pick one of about n/3 buckets.
+ *   - Each bucket gets a small displacement number d, found by the builder, such that
+ *     slot_of(hash, d) sends every key of every bucket to a different slot in 0..n-1.
+ *     Buckets with one key skip d and store their slot directly (DIRECT flag).
+ *   - A lookup reads one 4-byte seed, then one 8-byte slot, then the key's string.
+ *     The slot also holds 32 bits of the key's hash, so most misses stop right there.
+ *
+ * File layout (native byte order, checked by the magic number):
+ *
+ *   header   magic, version, nkeys, nbuckets, seed, section offsets, file size
+ *   seeds    uint32_t[nbuckets]  displacement d, or DIRECT | slot
+ *   slots    struct pht_slot[nkeys]  {hash check, offset of "NAME\0DEF\0"}
+ *   strings  all "NAME\0DEF\0" pairs back to back
+ *
+ * Usage:
+ *   ./perfect_hash_table                         run the tutorial demo
+ *   ./perfect_hash_table build IN OUT            build OUT from "NAME DEF" lines in IN
+ *                                                ("#define NAME DEF" lines work too)
+ *   ./perfect_hash_table lookup FILE NAME...     print the definitions of NAMEs
+ *   ./perfect_hash_table --bench [N]             startup and lookup time vs install()
+ *
+ * Author: Andrew M.
+ * Date: July 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PHT_MAGIC 0x31544850u    // "PHT1" when read in little-endian order
+#define PHT_VERSION 1
+#define KEYS_PER_BUCKET 3        // average bucket size the builder aims for
+#define DIRECT 0x80000000u       // seed flag: the low 31 bits are the slot itself
+#define MAX_DISPLACE 1000000u    // displacements tried per bucket before a new seed
+
+struct pht_header {
+    uint32_t magic, version;
+    uint64_t nkeys, nbuckets, seed;
+    uint64_t seeds_off, slots_off, strings_off, file_size;
+};
+
+struct pht_slot {
+    uint32_t check;          // low 32 bits of the key's hash
+    uint32_t off;            // where "NAME\0DEF\0" starts in the strings section
+};
+
+struct pht {                 // an open (mapped) table
+    const unsigned char *base;
+    size_t size;
+    const struct pht_header *hdr;
+    const uint32_t *seeds;
+    const struct pht_slot *slots;
+    const char *strings;
+};
+
+static struct pht table;     // the table lookup() reads from
+
+// Reads 8 bytes from any address (memcpy compiles to a single load)
+static uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 64x64 -> 128-bit multiply, folded back to 64 bits with xor
+static uint64_t mum(uint64_t a, uint64_t b) {
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+}
+
+// Hash function: the wyhash-style mix from hash_table_lookup.c, with a seed so the
+// builder can pick another hash function if the first one does not work out
+uint64_t hash(const char *s, uint64_t seed) {
+    const uint64_t p0 = 0xa0761d6478bd642full, p1 = 0xe7037ed1a0b428dbull;
+    const uint64_t p2 = 0x8ebc6af09c88c6e3ull, p3 = 0x589965cc75374cc3ull;
+    const unsigned char *p = (const unsigned char *)s;
+    size_t len = strlen(s);
+    uint64_t h = seed ^ p0 ^ mum(len ^ p1, p2), a, b;
+    for (; len > 16; len -= 16, p += 16)
+        h = mum(read64(p) ^ p1, read64(p + 8) ^ h);
+    if (len >= 8) {
+        a = read64(p);
+        b = read64(p + len - 8);
+    } else {
+        a = b = 0;
+        if (len >= 4) {
+            uint32_t lo, hi;
+            memcpy(&lo, p, 4);
+            memcpy(&hi, p + len - 4, 4);
+            a = lo;
+            b = hi;
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+        }
+    }
+    return mum(p1 ^ len, mum(a ^ p2, b ^ h) ^ p3);
+}
+
+// Scales a 64-bit value to 0..n-1 without a division
+static uint64_t scale(uint64_t x, uint64_t n) {
+    return (uint64_t)(((__uint128_t)x * n) >> 64);
+}
+
+// splitmix64 finalizer: turns (hash, displacement) into a fresh random-looking value
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static uint64_t bucket_of(uint64_t h, uint64_t nbuckets) { return scale(h, nbuckets); }
+
+static uint64_t slot_of(uint64_t h, uint32_t d, uint64_t nkeys) {
+    return scale(mix64(h + d * 0x9e3779b97f4a7c15ull), nkeys);
+}
+
+/* ---------- Lookup side: mmap and query ---------- */
+
+// Maps a table file and checks its header. Returns 0 on success.
+// The checks are O(1), so opening stays fast for any size; pht_lookup() checks the one
+// slot and string it reads, and the trailing '\0' here ends every string in the file.
+int pht_open(struct pht *t, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct pht_header)) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    const struct pht_header *h = (const struct pht_header *)p;
+    if (h->magic != PHT_MAGIC || h->version != PHT_VERSION || h->file_size != (uint64_t)st.st_size ||
+        h->seeds_off + h->nbuckets * sizeof(uint32_t) > h->slots_off ||
+        h->slots_off + h->nkeys * sizeof(struct pht_slot) > h->strings_off ||
+        h->strings_off > h->file_size || h->nbuckets == 0 ||
+        (h->nkeys > 0 && (h->strings_off == h->file_size || ((const char *)p)[st.st_size - 1] != '\0'))) {
+        munmap(p, st.st_size);
+        return -1;
+    }
+    t->base = (const unsigned char *)p;
+    t->size = st.st_size;
+    t->hdr = h;
+    t->seeds = (const uint32_t *)(t->base + h->seeds_off);
+    t->slots = (const struct pht_slot *)(t->base + h->slots_off);
+    t->strings = (const char *)(t->base + h->strings_off);
+    return 0;
+}
+
+void pht_close(struct pht *t) {
+    if (t->base) munmap((void *)t->base, t->size);
+    memset(t, 0, sizeof(*t));
+}
+
+// Finds a name in t and returns its definition (pointing into the mapping), or NULL
+const char *pht_lookup(const struct pht *t, const char *s) {
+    const struct pht_header *hdr = t->hdr;
+    if (hdr->nkeys == 0) return NULL;
+    uint64_t h = hash(s, hdr->seed);
+    uint32_t d = t->seeds[bucket_of(h, hdr->nbuckets)];
+    uint64_t slot = (d & DIRECT) ? d & ~DIRECT : slot_of(h, d, hdr->nkeys);
+    if (slot >= hdr->nkeys) return NULL;                        // corrupt DIRECT seed
+    struct pht_slot sl = t->slots[slot];
+    if (sl.check != (uint32_t)h || sl.off >= hdr->file_size - hdr->strings_off) return NULL;
+    const char *name = t->strings + sl.off, *end = (const char *)t->base + t->size;
+    while (*s && *s == *name) { ++s; ++name; }
+    if (*s != '\0' || *name != '\0' || name + 1 == end) return NULL;
+    return name + 1;                                            // DEF follows NAME's '\0'
+}
+
+// Lookup: the same call as in hash_table_lookup.c, answered from the mapped file
+const char *lookup(const char *s) {
+    return pht_lookup(&table, s);
+}
+
+/* ---------- Build side ---------- */
+
+struct key {
+    const char *name, *def;
+    uint64_t h;
+    size_t idx;              // input order, so a later duplicate replaces an earlier one
+};
+
+static int cmp_key(const void *a, const void *b) {
+    const struct key *x = (const struct key *)a, *y = (const struct key *)b;
+    if (x->h != y->h) return x->h < y->h ? -1 : 1;
+    int c = strcmp(x->name, y->name);
+    if (c) return c;
+    return x->idx < y->idx ? -1 : x->idx > y->idx;
+}
+
+static void *xmalloc(size_t n) {
+    void *p = malloc(n ? n : 1);
+    if (p == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+// Hashes keys with seed and sorts them; drops earlier duplicates of a name (like
+// install() updating a definition). Returns the new key count, or 0 with *collide
+// set if two different names share all 64 hash bits.
+static size_t hash_and_dedup(struct key *keys, size_t n, uint64_t seed, int *collide) {
+    size_t m = 0;
+    *collide = 0;
+    for (size_t i = 0; i < n; ++i) keys[i].h = hash(keys[i].name, seed);
+    qsort(keys, n, sizeof(*keys), cmp_key);
+    for (size_t i = 0; i < n; ++i) {
+        if (i + 1 < n && keys[i].h == keys[i + 1].h) {
+            if (strcmp(keys[i].name, keys[i + 1].name) == 0) continue;  // keep the later one
+            *collide = 1;
+            return 0;
+        }
+        keys[m++] = keys[i];
+    }
+    return m;
+}
+
+// Tries to find displacements for every bucket with this seed. Returns 0 on success.
+static int place(const struct key *keys, size_t n, uint64_t nbuckets, uint32_t *seeds, uint32_t *slot_key) {
+    size_t *start = (size_t *)xmalloc((nbuckets + 1) * sizeof(size_t));
+    size_t *members = (size_t *)xmalloc(n * sizeof(size_t));
+    size_t *order = (size_t *)xmalloc(nbuckets * sizeof(size_t));
+    size_t by_size[64] = {0};
+    uint64_t slots[64];
+    int ok = 0;
+
+    // Counting sort: key indexes grouped by bucket
+    memset(start, 0, (nbuckets + 1) * sizeof(size_t));
+    for (size_t i = 0; i < n; ++i) start[bucket_of(keys[i].h, nbuckets) + 1]++;
+    for (uint64_t b = 0; b < nbuckets; ++b) {
+        if (start[b + 1] >= 64) goto out;       // absurdly unlucky seed: try another
+        by_size[start[b + 1]]++;
+        start[b + 1] += start[b];
+    }
+    {
+        size_t *pos = (size_t *)xmalloc(nbuckets * sizeof(size_t));
+        memcpy(pos, start, nbuckets * sizeof(size_t));
+        for (size_t i = 0; i < n; ++i) members[pos[bucket_of(keys[i].h, nbuckets)]++] = i;
+        free(pos);
+    }
+
+    // Buckets from largest to smallest: big buckets are placed while slots are plentiful
+    size_t at[64];
+    for (int s = 63, acc = 0; s >= 0; --s) { at[s] = acc; acc += by_size[s]; }
+    for (uint64_t b = 0; b < nbuckets; ++b) order[at[start[b + 1] - start[b]]++] = b;
+
+    for (size_t i = 0; i < n; ++i) slot_key[i] = UINT32_MAX;
+    size_t next_free = 0;
+    for (uint64_t k = 0; k < nbuckets; ++k) {
+        uint64_t b = order[k];
+        size_t size = start[b + 1] - start[b];
+        const size_t *mem = members + start[b];
+        if (size == 0) {
+            seeds[b] = 0;
+        } else if (size == 1) {
+            // Singleton: no hashing needed, just take the next free slot
+            while (slot_key[next_free] != UINT32_MAX) ++next_free;
+            slot_key[next_free] = (uint32_t)mem[0];
+            seeds[b] = DIRECT | (uint32_t)next_free;
+        } else {
+            uint32_t d;
+            for (d = 0; d < MAX_DISPLACE; ++d) {
+                size_t j;
+                for (j = 0; j < size; ++j) {
+                    slots[j] = slot_of(keys[mem[j]].h, d, n);
+                    if (slot_key[slots[j]] != UINT32_MAX) break;
+                    size_t q;
+                    for (q = 0; q < j && slots[q] != slots[j]; ++q) ;
+                    if (q < j) break;
+                }
+                if (j == size) break;
+            }
+            if (d == MAX_DISPLACE) goto out;
+            for (size_t j = 0; j < size; ++j) slot_key[slots[j]] = (uint32_t)mem[j];
+            seeds[b] = d;
+        }
+    }
+    ok = 1;
+out:
+    free(start);
+    free(members);
+    free(order);
+    return ok ? 0 : -1;
+}
+
+// Builds a table for keys[0..n-1] and writes it to path. Returns the key count or -1.
+long pht_build(struct key *keys, size_t n, const char *path) {
+    uint64_t seed = 0;
+    size_t m = 0;
+    uint64_t nbuckets = 1;
+    uint32_t *seeds = NULL, *slot_key = NULL;
+    if (n >= DIRECT) {
+        fprintf(stderr, "[Error] too many keys\n");
+        return -1;
+    }
+    for (int attempt = 0;; ++attempt, seed = mix64(seed + attempt)) {
+        if (attempt == 100) {
+            fprintf(stderr, "[Error] could not build a perfect hash\n");
+            return -1;
+        }
+        int collide;
+        m = hash_and_dedup(keys, n, seed, &collide);
+        if (collide) continue;
+        n = m;       // duplicates are gone for good
+        nbuckets = m / KEYS_PER_BUCKET + 1;
+        free(seeds);
+        free(slot_key);
+        seeds = (uint32_t *)xmalloc(nbuckets * sizeof(uint32_t));
+        slot_key = (uint32_t *)xmalloc(m * sizeof(uint32_t));
+        if (place(keys, m, nbuckets, seeds, slot_key) == 0) break;
+    }
+
+    // Lay out the file: header, seeds, slots, then strings in slot order
+    struct pht_header hdr = {PHT_MAGIC, PHT_VERSION, m, nbuckets, seed, 0, 0, 0, 0};
+    hdr.seeds_off = sizeof(hdr);
+    hdr.slots_off = (hdr.seeds_off + nbuckets * sizeof(uint32_t) + 7) & ~(uint64_t)7;
+    hdr.strings_off = hdr.slots_off + m * sizeof(struct pht_slot);
+    struct pht_slot *slots = (struct pht_slot *)xmalloc(m * sizeof(struct pht_slot));
+    uint64_t off = 0;
+    for (size_t i = 0; i < m; ++i) {
+        const struct key *k = &keys[slot_key[i]];
+        slots[i].check = (uint32_t)k->h;
+        slots[i].off = (uint32_t)off;
+        off += strlen(k->name) + strlen(k->def) + 2;
+        if (off > UINT32_MAX) {
+            fprintf(stderr, "[Error] strings exceed 4 GB\n");
+            return -1;
+        }
+    }
+    hdr.file_size = hdr.strings_off + off;
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    static const char pad[8];
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    fwrite(seeds, sizeof(uint32_t), nbuckets, f);
+    fwrite(pad, 1, hdr.slots_off - hdr.seeds_off - nbuckets * sizeof(uint32_t), f);
+    fwrite(slots, sizeof(struct pht_slot), m, f);
+    for (size_t i = 0; i < m; ++i) {
+        const struct key *k = &keys[slot_key[i]];
+        fwrite(k->name, 1, strlen(k->name) + 1, f);
+        fwrite(k->def, 1, strlen(k->def) + 1, f);
+    }
+    int err = ferror(f);
+    if (fclose(f) != 0 || err) {
+        perror(path);
+        return -1;
+    }
+    free(seeds);
+    free(slot_key);
+    free(slots);
+    return (long)m;
+}
+
+// Reads "NAME DEF" (or "#define NAME DEF") lines into keys; the text is kept in *buf
+static size_t read_pairs(const char *path, char **buf, struct key **keys) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return (size_t)-1;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = (char *)xmalloc(len + 1);
+    size_t got = fread(text, 1, len, f);
+    fclose(f);
+    text[got] = '\0';
+
+    size_t n = 0, cap = 1024;
+    struct key *k = (struct key *)xmalloc(cap * sizeof(*k));
+    for (char *line = text, *next; *line; line = next) {
+        next = strchr(line, '\n');
+        if (next) *next++ = '\0'; else next = line + strlen(line);
+        char *p = line + strspn(line, " \t\r");
+        if (strncmp(p, "#define", 7) == 0 && (p[7] == ' ' || p[7] == '\t'))
+            p += 7 + strspn(p + 7, " \t");
+        if (*p == '\0' || *p == '#') continue;          // blank line or comment
+        char *name = p;
+        p += strcspn(p, " \t\r");
+        if (*p) *p++ = '\0';
+        p += strspn(p, " \t");
+        char *end = p + strlen(p);
+        while (end > p && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+        if (n == cap) {
+            cap *= 2;
+            k = (struct key *)realloc(k, cap * sizeof(*k));
+            if (k == NULL) {
+                fprintf(stderr, "[Error] out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        k[n].name = name;
+        k[n].def = p;
+        k[n].idx = n;
+        ++n;
+    }
+    *buf = text;
+    *keys = k;
+    return n;
+}
+
+/* ---------- Demo and benchmark ---------- */
+
+void run_demo() {
+    printf("Andrew M's Perfect Hash Table Tutorial\n");
+    printf("--------------------------------------\n");
+    struct key pairs[] = {
+        {"YES", "1", 0, 0}, {"NO", "0", 0, 1}, {"PI", "3.14159", 0, 2},
+        {"HELLO", "world", 0, 3}, {"YES", "42", 0, 4}  // later duplicate wins
+    };
+    char path[] = "/tmp/pht_demoXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return;
+    }
+    close(fd);
+    long n = pht_build(pairs, 5, path);
+    printf("Built %s with %ld keys\n", path, n);
+    if (pht_open(&table, path) != 0) {
+        fprintf(stderr, "[Error] cannot open %s\n", path);
+        unlink(path);
+        return;
+    }
+    printf("File: %zu bytes, %llu buckets, seed %llu\n", table.size,
+           (unsigned long long)table.hdr->nbuckets, (unsigned long long)table.hdr->seed);
+    for (uint64_t b = 0; b < table.hdr->nbuckets; ++b) {
+        uint32_t d = table.seeds[b];
+        if (d & DIRECT) printf("  bucket %llu: direct slot %u\n", (unsigned long long)b, d & ~DIRECT);
+        else printf("  bucket %llu: displacement %u\n", (unsigned long long)b, d);
+    }
+
+    printf("\nLooking up some names...\n");
+    const char *names[] = {"YES", "NO", "PI", "HELLO", "MISSING"};
+    for (int i = 0; i < 5; ++i) {
+        const char *def = lookup(names[i]);
+        if (def)
+            printf("lookup('%s') => '%s'\n", names[i], def);
+        else
+            printf("lookup('%s') => not found\n", names[i]);
+    }
+    pht_close(&table);
+    unlink(path);
+}
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Baseline: the textbook chained table, built with one install() per pair at startup
+struct nlist {
+    char *name, *def;
+    struct nlist *next;
+};
+
+static struct nlist **chain_tab;
+static size_t chain_size;
+
+static struct nlist *chain_lookup(const char *s) {
+    struct nlist *np = chain_tab[hash(s, 0) & (chain_size - 1)];
+    for (; np; np = np->next)
+        if (strcmp(s, np->name) == 0) return np;
+    return NULL;
+}
+
+static void chain_install(const char *name, const char *def) {
+    struct nlist *np = chain_lookup(name);
+    if (np == NULL) {
+        np = (struct nlist *)xmalloc(sizeof(*np));
+        np->name = strdup(name);
+        size_t b = hash(name, 0) & (chain_size - 1);
+        np->next = chain_tab[b];
+        chain_tab[b] = np;
+    } else {
+        free(np->def);
+    }
+    np->def = strdup(def);
+}
+
+void run_bench(size_t n) {
+    enum { NAMELEN = 32, LOOKUPS = 2000000 };
+    char *names = (char *)xmalloc(2 * n * NAMELEN);  // n names, then n names not in the table
+    char *defs = (char *)xmalloc(n * 12);
+    struct key *keys = (struct key *)xmalloc(n * sizeof(*keys));
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(names + i * NAMELEN, NAMELEN, "MACRO_%zu", i);
+        snprintf(names + (n + i) * NAMELEN, NAMELEN, "OTHER_%zu", i);
+        snprintf(defs + i * 12, 12, "%zu", i % 1000);
+        keys[i] = (struct key){names + i * NAMELEN, defs + i * 12, 0, i};
+    }
+
+    char path[] = "/tmp/pht_benchXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return;
+    }
+    close(fd);
+    double t0 = now_sec();
+    if (pht_build(keys, n, path) < 0) return;
+    double t_build = now_sec() - t0;
+
+    t0 = now_sec();
+    for (chain_size = 16; chain_size < n; chain_size *= 2) ;
+    chain_tab = (struct nlist **)calloc(chain_size, sizeof(*chain_tab));
+    for (size_t i = 0; i < n; ++i) chain_install(keys[i].name, keys[i].def);
+    double t_install = now_sec() - t0;
+
+    t0 = now_sec();
+    if (pht_open(&table, path) != 0) {
+        fprintf(stderr, "[Error] cannot open %s\n", path);
+        return;
+    }
+    double t_open = now_sec() - t0;
+
+    printf("Perfect hash table: %zu keys, file %zu bytes (%.1f bytes/key, %.1f bits/key of hash function)\n",
+           n, table.size, (double)table.size / n, 32.0 * table.hdr->nbuckets / n);
+    printf("Startup:  install() x %zu: %9.3f ms   mmap open: %9.3f ms   (offline build: %.3f ms)\n",
+           n, t_install * 1e3, t_open * 1e3, t_build * 1e3);
+
+    printf("%8s %16s %16s\n", "miss%", "chained ns/op", "mmap PHF ns/op");
+    for (int miss = 0; miss <= 100; miss += 50) {
+        double ns[2];
+        size_t found[2] = {0, 0};
+        for (int which = 0; which < 2; ++which) {
+            uint64_t x = 0x9e3779b97f4a7c15ull;
+            t0 = now_sec();
+            for (int i = 0; i < LOOKUPS; ++i) {
+                x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+                size_t k = (x >> 8) % n + ((int)(x % 100) < miss ? n : 0);
+                const char *name = names + k * NAMELEN;
+                found[which] += which ? lookup(name) != NULL : chain_lookup(name) != NULL;
+            }
+            ns[which] = (now_sec() - t0) * 1e9 / LOOKUPS;
+        }
+        if (found[0] != found[1]) printf("[Error] the two tables disagree\n");
+        printf("%8d %16.1f %16.1f\n", miss, ns[0], ns[1]);
+    }
+
+    pht_close(&table);
+    unlink(path);
+    for (size_t i = 0; i < chain_size; ++i) {
+        for (struct nlist *np = chain_tab[i], *next; np; np = next) {
+            next = np->next;
+            free(np->name);
+            free(np->def);
+            free(np);
+        }
+    }
+    free(chain_tab);
+    free(names);
+    free(defs);
+    free(keys);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+        if (n == 0) {
+            fprintf(stderr, "[Error] --bench needs a positive number of keys\n");
+            return EXIT_FAILURE;
+        }
+        run_bench(n);
+    } else if (argc == 4 && strcmp(argv[1], "build") == 0) {
+        char *text;
+        struct key *keys;
+        size_t n = read_pairs(argv[2], &text, &keys);
+        if (n == (size_t)-1) return EXIT_FAILURE;
+        long m = pht_build(keys, n, argv[3]);
+        free(text);
+        free(keys);
+        if (m < 0) return EXIT_FAILURE;
+        printf("Wrote %s: %ld keys\n", argv[3], m);
+    } else if (argc >= 3 && strcmp(argv[1], "lookup") == 0) {
+        if (pht_open(&table, argv[2]) != 0) {
+            fprintf(stderr, "[Error] %s is not a table file\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        for (int i = 3; i < argc; ++i) {
+            const char *def = lookup(argv[i]);
+            printf("%s => %s\n", argv[i], def ? def : "(not found)");
+        }
+        pht_close(&table);
+    } else {
+        run_demo();
+    }
+    return 0;
+}
+
+/*
+Tutorial Notes:
+- A perfect hash function maps n known keys to n slots with no collisions.
+- The expensive search for it happens once, offline; lookups just replay the answer.
+- mmap() makes the file usable at once: pages are read in only when a lookup touches them.
+- A lookup reads one seed, one slot and one string: no chains and no probing.
+- Keys not in the table are caught by the 32-bit hash check, then by comparing names.
+*/
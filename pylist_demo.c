@@ -6,6 +6,38 @@
  * This program demonstrates a dynamic list type in C, inspired by Python's list class.
  * It features append, print, length, and index operations, with detailed debug output.
  *
+ * An array of pointers, like CPython's list:
+ *   The first version was a singly linked list of nodes. Getting item i meant following
+ *   i next pointers, and walking the list took a cache miss per node. Now a pylist is
+ *   one array of char * (items[0..count)), so pylist_get(i) is a single load and a walk
+ *   reads consecutive memory. When the array is full it grows to about 1.125 times the
+ *   needed size plus a few slots (the same rule CPython uses), so a run of appends
+ *   copies each pointer only a constant number of times on average. pylist_insert() and
+ *   pylist_pop() move the items after i with one memmove() of pointers, never the
+ *   strings; pylist_extend() reserves room for all new items once.
+ *   Indexes work as in Python: -1 is the last item.
+ *
+ * Sorting and sorted lists:
+ *   pylist_sort() sorts in place, stably, with any comparator. It is a Timsort like
+ *   CPython's list.sort(): real data is often partly in order, so it first finds the
+ *   runs that already are (ascending, or strictly descending and then reversed), makes
+ *   short runs up to a minimum length with binary insertion sort, and keeps a stack of
+ *   runs that it merges while their lengths stay balanced. A merge first skips the items
+ *   already in place; when one side wins MIN_GALLOP times in a row it "gallops":
+ *   exponential then binary search for how many items in a row come from that side,
+ *   copied with one memcpy(). A sorted list then costs n - 1 comparisons, and a few
+ *   misplaced items little more than that. On a sorted list, pylist_bisect_left() /
+ *   pylist_bisect_right() find an item's place in O(log n), pylist_insort() inserts
+ *   there, and pylist_index_sorted() tests membership without a scan.
+ *
+ * Usage:
+ *   ./pylist_demo              the demo, tracing every step
+ *   ./pylist_demo --bench [N]  append N (default 1M) items, random gets and a full walk,
+ *                              against the old linked list
+ *   ./pylist_demo --bench-sort [N]  pylist_sort() on N (default 1M) random, sorted,
+ *                              reversed and partly sorted items, against qsort(); and
+ *                              bisection against pylist_index()
+ *
  * Author: Andrew M.
  * Date: July 2025
  */
@@ -13,98 +45,801 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-struct lnode {
-    char *text;
-    struct lnode *next;
-};
+#include <time.h>
 
 struct pylist {
-    struct lnode *head;
-    struct lnode *tail;
+    char **items;            /* count strings, each owned by the list */
     int count;
+    int alloc;               /* slots in items */
 };
 
+static int trace = 1;        // print a line for every step (off in the benchmark)
+
+#define TRACE(...) do { if (trace) printf(__VA_ARGS__); } while (0)
+
 struct pylist * pylist_new() {
     struct pylist *p = malloc(sizeof(*p));
-    p->head = NULL;
-    p->tail = NULL;
+    if (!p) {
+        fprintf(stderr, "[Error] pylist_new: malloc failed\n");
+        exit(EXIT_FAILURE);
+    }
+    p->items = NULL;
     p->count = 0;
-    printf("[pylist_new] Created new pylist@%p\n", (void*)p);
+    p->alloc = 0;
+    TRACE("[pylist_new] Created new pylist@%p\n", (void*)p);
     return p;
 }
 
 void pylist_del(struct pylist* self) {
-    printf("[pylist_del] Deleting pylist@%p\n", (void*)self);
-    struct lnode *cur, *next;
-    cur = self->head;
-    while(cur) {
-        printf("  [pylist_del] Freeing lnode@%p text='%s'\n", (void*)cur, cur->text);
-        free(cur->text);
-        next = cur->next;
-        free(cur);
-        cur = next;
+    TRACE("[pylist_del] Deleting pylist@%p\n", (void*)self);
+    for (int i = 0; i < self->count; ++i) {
+        TRACE("  [pylist_del] Freeing item %d text='%s'\n", i, self->items[i]);
+        free(self->items[i]);
     }
+    free(self->items);
     free((void *)self);
 }
 
-void pylist_append(struct pylist *self, const char *text) {
-    printf("[pylist_append] Appending '%s' to pylist@%p\n", text, (void*)self);
-    struct lnode *node = malloc(sizeof(struct lnode));
-    if (!node) {
-        fprintf(stderr, "[Error] pylist_append: malloc failed\n");
+// Makes room for at least n items, over-allocating like CPython's list_resize()
+void pylist_reserve(struct pylist *self, int n) {
+    if (n <= self->alloc) return;
+    int newalloc = (n + (n >> 3) + 6) & ~3;
+    char **items = realloc(self->items, (size_t)newalloc * sizeof(char *));
+    if (!items) {
+        fprintf(stderr, "[Error] pylist_reserve: out of memory\n");
         exit(EXIT_FAILURE);
     }
-    node->text = strdup(text);
-    node->next = NULL;
-    if (self->tail) {
-        self->tail->next = node;
-        printf("  [pylist_append] Linked new node@%p after tail@%p\n", (void*)node, (void*)self->tail);
-    } else {
-        self->head = node;
-        printf("  [pylist_append] First node@%p set as head\n", (void*)node);
+    TRACE("  [pylist_reserve] items array grown from %d to %d slots, now at %p\n", self->alloc, newalloc, (void*)items);
+    self->items = items;
+    self->alloc = newalloc;
+}
+
+static char *dup_text(const char *text) {
+    char *t = strdup(text);
+    if (!t) {
+        fprintf(stderr, "[Error] pylist: strdup failed\n");
+        exit(EXIT_FAILURE);
     }
-    self->tail = node;
-    self->count++;
-    printf("  [pylist_append] New tail@%p, count=%d\n", (void*)node, self->count);
+    return t;
+}
+
+// Python-style index: negative counts from the end; -1 when out of range
+static int pylist_pos(const struct pylist *self, int i) {
+    if (i < 0) i += self->count;
+    return i >= 0 && i < self->count ? i : -1;
+}
+
+void pylist_append(struct pylist *self, const char *text) {
+    TRACE("[pylist_append] Appending '%s' to pylist@%p\n", text, (void*)self);
+    pylist_reserve(self, self->count + 1);
+    self->items[self->count++] = dup_text(text);
+    TRACE("  [pylist_append] Stored at index %d, count=%d\n", self->count - 1, self->count);
 }
 
 void pylist_print(const struct pylist *self) {
     printf("[");
-    struct lnode *cur = self->head;
-    int first = 1;
-    while (cur) {
-        if (!first) printf(", ");
-        printf("'%s'", cur->text);
-        first = 0;
-        cur = cur->next;
+    for (int i = 0; i < self->count; ++i) {
+        if (i > 0) printf(", ");
+        printf("'%s'", self->items[i]);
     }
     printf("]\n");
 }
 
 int pylist_len(const struct pylist *self) {
-    printf("[pylist_len] pylist@%p count=%d\n", (void*)self, self->count);
+    TRACE("[pylist_len] pylist@%p count=%d\n", (void*)self, self->count);
     return self->count;
 }
 
 int pylist_index(const struct pylist *self, const char *text) {
-    printf("[pylist_index] Searching for '%s' in pylist@%p\n", text, (void*)self);
-    struct lnode *cur = self->head;
-    int idx = 0;
-    while (cur) {
-        if (strcmp(cur->text, text) == 0) {
-            printf("  [pylist_index] Found at index %d (lnode@%p)\n", idx, (void*)cur);
-            return idx;
+    TRACE("[pylist_index] Searching for '%s' in pylist@%p\n", text, (void*)self);
+    for (int i = 0; i < self->count; ++i) {
+        if (strcmp(self->items[i], text) == 0) {
+            TRACE("  [pylist_index] Found at index %d\n", i);
+            return i;
         }
-        cur = cur->next;
-        idx++;
     }
-    printf("  [pylist_index] Not found\n");
+    TRACE("  [pylist_index] Not found\n");
     return -1;
 }
 
-int main(void)
+/**
+ * self[i], or NULL (with a message) when i is out of range. O(1).
+ */
+const char *pylist_get(const struct pylist *self, int i) {
+    int pos = pylist_pos(self, i);
+    if (pos < 0) {
+        fprintf(stderr, "[Error] pylist_get: index %d out of range\n", i);
+        return NULL;
+    }
+    return self->items[pos];
+}
+
+/**
+ * self[i] = text (a copy); the old string is freed.
+ */
+void pylist_set(struct pylist *self, int i, const char *text) {
+    int pos = pylist_pos(self, i);
+    if (pos < 0) {
+        fprintf(stderr, "[Error] pylist_set: index %d out of range\n", i);
+        return;
+    }
+    TRACE("[pylist_set] Index %d: '%s' -> '%s'\n", pos, self->items[pos], text);
+    char *copy = dup_text(text);    // text may be the item being replaced
+    free(self->items[pos]);
+    self->items[pos] = copy;
+}
+
+/**
+ * Inserts a copy of text before index i (clamped to 0..count, as in Python).
+ */
+void pylist_insert(struct pylist *self, int i, const char *text) {
+    if (i < 0) i += self->count;
+    if (i < 0) i = 0;
+    if (i > self->count) i = self->count;
+    TRACE("[pylist_insert] Inserting '%s' at index %d, moving %d pointers\n", text, i, self->count - i);
+    pylist_reserve(self, self->count + 1);
+    memmove(self->items + i + 1, self->items + i, (size_t)(self->count - i) * sizeof(char *));
+    self->items[i] = dup_text(text);
+    self->count++;
+}
+
+/**
+ * Removes item i and returns it; the caller frees it. NULL when i is out of range.
+ */
+char *pylist_pop(struct pylist *self, int i) {
+    int pos = pylist_pos(self, i);
+    if (pos < 0) {
+        fprintf(stderr, "[Error] pylist_pop: index %d out of range\n", i);
+        return NULL;
+    }
+    char *text = self->items[pos];
+    TRACE("[pylist_pop] Removing '%s' at index %d, moving %d pointers\n", text, pos, self->count - pos - 1);
+    memmove(self->items + pos, self->items + pos + 1, (size_t)(self->count - pos - 1) * sizeof(char *));
+    self->count--;
+    return text;
+}
+
+/**
+ * A new list with copies of self[start:stop] (clamped; negative values count from the end).
+ */
+struct pylist *pylist_slice(const struct pylist *self, int start, int stop) {
+    if (start < 0) start += self->count;
+    if (stop < 0) stop += self->count;
+    if (start < 0) start = 0;
+    if (stop > self->count) stop = self->count;
+    struct pylist *out = pylist_new();
+    TRACE("[pylist_slice] [%d:%d] of pylist@%p\n", start, stop, (void*)self);
+    if (start >= stop) return out;
+    pylist_reserve(out, stop - start);
+    for (int i = start; i < stop; ++i) out->items[out->count++] = dup_text(self->items[i]);
+    return out;
+}
+
+/**
+ * Appends copies of all of other's items, after growing the array once.
+ */
+void pylist_extend(struct pylist *self, const struct pylist *other) {
+    int n = other->count;            // other may be self
+    TRACE("[pylist_extend] Adding %d items to pylist@%p\n", n, (void*)self);
+    pylist_reserve(self, self->count + n);
+    for (int i = 0; i < n; ++i) self->items[self->count++] = dup_text(other->items[i]);
+}
+
+/* ---------- Sorting and bisection ---------- */
+
+typedef int (*pylist_cmp)(const char *a, const char *b);   // < 0, 0, > 0 like strcmp()
+
+#define MIN_GALLOP 7         // start galloping after this many wins in a row
+#define MAX_RUNS 85          // run lengths grow like Fibonacci numbers: plenty for 2^64 items
+
+struct sortstate {
+    pylist_cmp cmp;
+    char **tmp;              // room for the shorter run of a merge
+    int tmpcap;
+    int min_gallop;          // adapts: lower while galloping pays off
+    int nruns;
+    struct { char **base; int len; } runs[MAX_RUNS];
+};
+
+#define LESS(st, x, y) ((st)->cmp((x), (y)) < 0)
+
+// Minimum run length: n / minrun is a power of 2 or just below, for balanced merges
+static int min_run(int n) {
+    int r = 0;
+    while (n >= 64) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+// Length of the run starting at a[0]; a strictly descending run is reversed in place
+static int count_run(struct sortstate *st, char **a, int n) {
+    int k = 1;
+    if (n == 1) return 1;
+    if (LESS(st, a[1], a[0])) {
+        while (k + 1 < n && LESS(st, a[k + 1], a[k])) ++k;
+        ++k;
+        for (int i = 0, j = k - 1; i < j; ++i, --j) {
+            char *t = a[i];
+            a[i] = a[j];
+            a[j] = t;
+        }
+        return k;
+    }
+    while (k < n && !LESS(st, a[k], a[k - 1])) ++k;
+    return k;
+}
+
+// Sorts a[0..n) given a[0..start) is sorted: binary search, then one memmove per item
+static void binary_insertion(struct sortstate *st, char **a, int n, int start) {
+    for (int i = start; i < n; ++i) {
+        char *pivot = a[i];
+        int lo = 0, hi = i;
+        while (lo < hi) {            // first item greater than pivot keeps equal items in order
+            int m = lo + (hi - lo) / 2;
+            if (LESS(st, pivot, a[m])) hi = m;
+            else lo = m + 1;
+        }
+        memmove(a + lo + 1, a + lo, (size_t)(i - lo) * sizeof(char *));
+        a[lo] = pivot;
+    }
+}
+
+/*
+ * Where key goes in sorted a[0..n): gallop_left returns the first k with key <= a[k],
+ * gallop_right the first k with key < a[k]. Both start at hint and step 1, 3, 7, 15, ...
+ * until they pass the spot, then binary-search the last step: O(log d) for a distance d.
+ */
+static int gallop_left(struct sortstate *st, char *key, char **a, int n, int hint) {
+    int ofs = 1, lastofs = 0, k;
+    if (LESS(st, a[hint], key)) {
+        int maxofs = n - hint;
+        while (ofs < maxofs && LESS(st, a[hint + ofs], key)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0) ofs = maxofs;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        lastofs += hint;
+        ofs += hint;
+    } else {
+        int maxofs = hint + 1;
+        while (ofs < maxofs && !LESS(st, a[hint - ofs], key)) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0) ofs = maxofs;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    }
+    // a[lastofs] < key <= a[ofs]
+    ++lastofs;
+    while (lastofs < ofs) {
+        int m = lastofs + (ofs - lastofs) / 2;
+        if (LESS(st, a[m], key)) lastofs = m + 1;
+        else ofs = m;
+    }
+    return ofs;
+}
+
+static int gallop_right(struct sortstate *st, char *key, char **a, int n, int hint) {
+    int ofs = 1, lastofs = 0, k;
+    if (LESS(st, key, a[hint])) {
+        int maxofs = hint + 1;
+        while (ofs < maxofs && LESS(st, key, a[hint - ofs])) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0) ofs = maxofs;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        k = lastofs;
+        lastofs = hint - ofs;
+        ofs = hint - k;
+    } else {
+        int maxofs = n - hint;
+        while (ofs < maxofs && !LESS(st, key, a[hint + ofs])) {
+            lastofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= 0) ofs = maxofs;
+        }
+        if (ofs > maxofs) ofs = maxofs;
+        lastofs += hint;
+        ofs += hint;
+    }
+    // a[lastofs] <= key < a[ofs]
+    ++lastofs;
+    while (lastofs < ofs) {
+        int m = lastofs + (ofs - lastofs) / 2;
+        if (LESS(st, key, a[m])) ofs = m;
+        else lastofs = m + 1;
+    }
+    return ofs;
+}
+
+static char **sort_tmp(struct sortstate *st, int n) {
+    if (n > st->tmpcap) {
+        free(st->tmp);
+        st->tmp = malloc((size_t)n * sizeof(char *));
+        if (!st->tmp) {
+            fprintf(stderr, "[Error] pylist_sort: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        st->tmpcap = n;
+    }
+    return st->tmp;
+}
+
+/*
+ * Merges the adjacent runs a[0..na) and b[0..nb) = a[na..na+nb), with na <= nb: a is
+ * moved to tmp and the merge fills from the left. While one run keeps winning, it
+ * switches to galloping, which finds how many items in a row come from that run.
+ */
+static void merge_lo(struct sortstate *st, char **a, int na, char **b, int nb) {
+    char **dest = a, **pa = memcpy(sort_tmp(st, na), a, (size_t)na * sizeof(char *)), **pb = b;
+    int min_gallop = st->min_gallop, k;
+    *dest++ = *pb++;
+    if (--nb == 0) goto done;
+    if (na == 1) goto copy_b;
+    for (;;) {
+        int acount = 0, bcount = 0;
+        do {                         // one item at a time
+            if (LESS(st, *pb, *pa)) {
+                *dest++ = *pb++;
+                ++bcount;
+                acount = 0;
+                if (--nb == 0) goto done;
+            } else {
+                *dest++ = *pa++;
+                ++acount;
+                bcount = 0;
+                if (--na == 1) goto copy_b;
+            }
+        } while ((acount | bcount) < min_gallop);
+        ++min_gallop;
+        do {                         // galloping
+            min_gallop -= min_gallop > 1;
+            st->min_gallop = min_gallop;
+            k = acount = gallop_right(st, *pb, pa, na, 0);
+            if (k) {
+                memcpy(dest, pa, (size_t)k * sizeof(char *));
+                dest += k;
+                pa += k;
+                na -= k;
+                if (na == 1) goto copy_b;
+                if (na == 0) goto done;      // only with an inconsistent comparator
+            }
+            *dest++ = *pb++;
+            if (--nb == 0) goto done;
+            k = bcount = gallop_left(st, *pa, pb, nb, 0);
+            if (k) {
+                memmove(dest, pb, (size_t)k * sizeof(char *));
+                dest += k;
+                pb += k;
+                nb -= k;
+                if (nb == 0) goto done;
+            }
+            *dest++ = *pa++;
+            if (--na == 1) goto copy_b;
+        } while (acount >= MIN_GALLOP || bcount >= MIN_GALLOP);
+        ++min_gallop;                // galloping stopped paying: make it harder to start
+        st->min_gallop = min_gallop;
+    }
+done:
+    if (na) memcpy(dest, pa, (size_t)na * sizeof(char *));
+    return;
+copy_b:
+    memmove(dest, pb, (size_t)nb * sizeof(char *));
+    dest[nb] = *pa;                  // the last item of a is greater than all of b
+}
+
+// The mirror image of merge_lo for na > nb: b is moved to tmp, and the merge fills from the right
+static void merge_hi(struct sortstate *st, char **a, int na, char **b, int nb) {
+    char **basea = a, **baseb = memcpy(sort_tmp(st, nb), b, (size_t)nb * sizeof(char *));
+    char **dest = b + nb - 1, **pa = a + na - 1, **pb = baseb + nb - 1;
+    int min_gallop = st->min_gallop, k;
+    *dest-- = *pa--;
+    if (--na == 0) goto done;
+    if (nb == 1) goto copy_a;
+    for (;;) {
+        int acount = 0, bcount = 0;
+        do {
+            if (LESS(st, *pb, *pa)) {
+                *dest-- = *pa--;
+                ++acount;
+                bcount = 0;
+                if (--na == 0) goto done;
+            } else {
+                *dest-- = *pb--;
+                ++bcount;
+                acount = 0;
+                if (--nb == 1) goto copy_a;
+            }
+        } while ((acount | bcount) < min_gallop);
+        ++min_gallop;
+        do {
+            min_gallop -= min_gallop > 1;
+            st->min_gallop = min_gallop;
+            k = acount = na - gallop_right(st, *pb, basea, na, na - 1);
+            if (k) {
+                dest -= k;
+                pa -= k;
+                memmove(dest + 1, pa + 1, (size_t)k * sizeof(char *));
+                na -= k;
+                if (na == 0) goto done;
+            }
+            *dest-- = *pb--;
+            if (--nb == 1) goto copy_a;
+            k = bcount = nb - gallop_left(st, *pa, baseb, nb, nb - 1);
+            if (k) {
+                dest -= k;
+                pb -= k;
+                memcpy(dest + 1, pb + 1, (size_t)k * sizeof(char *));
+                nb -= k;
+                if (nb == 1) goto copy_a;
+                if (nb == 0) goto done;      // only with an inconsistent comparator
+            }
+            *dest-- = *pa--;
+            if (--na == 0) goto done;
+        } while (acount >= MIN_GALLOP || bcount >= MIN_GALLOP);
+        ++min_gallop;
+        st->min_gallop = min_gallop;
+    }
+done:
+    if (nb) memcpy(dest - (nb - 1), baseb, (size_t)nb * sizeof(char *));
+    return;
+copy_a:
+    dest -= na;
+    pa -= na;
+    memmove(dest + 1, pa + 1, (size_t)na * sizeof(char *));
+    *dest = *pb;                     // the first item of b is less than all of a
+}
+
+// Merges runs i and i + 1 of the stack
+static void merge_at(struct sortstate *st, int i) {
+    char **a = st->runs[i].base, **b = st->runs[i + 1].base;
+    int na = st->runs[i].len, nb = st->runs[i + 1].len;
+    st->runs[i].len = na + nb;
+    if (i == st->nruns - 3) st->runs[i + 1] = st->runs[i + 2];
+    --st->nruns;
+    // Items of a that are <= b[0], and items of b that are >= a[na - 1], are already in place
+    int k = gallop_right(st, b[0], a, na, 0);
+    a += k;
+    na -= k;
+    if (na == 0) return;
+    nb = gallop_left(st, a[na - 1], b, nb, nb - 1);
+    if (nb == 0) return;
+    if (na <= nb) merge_lo(st, a, na, b, nb);
+    else merge_hi(st, a, na, b, nb);
+}
+
+// Merges until the run lengths on the stack shrink faster than Fibonacci numbers
+static void merge_collapse(struct sortstate *st) {
+    while (st->nruns > 1) {
+        int i = st->nruns - 2;
+        if ((i > 0 && st->runs[i - 1].len <= st->runs[i].len + st->runs[i + 1].len) ||
+            (i > 1 && st->runs[i - 2].len <= st->runs[i - 1].len + st->runs[i].len)) {
+            if (st->runs[i - 1].len < st->runs[i + 1].len) --i;
+        } else if (st->runs[i].len > st->runs[i + 1].len) {
+            break;
+        }
+        merge_at(st, i);
+    }
+}
+
+static int cmp_text(const char *a, const char *b) {
+    return strcmp(a, b);
+}
+
+/**
+ * Sorts the list in place, stably, by cmp (NULL: strcmp). Timsort, as in CPython: it
+ * finds the runs already in order (reversing descending ones), extends short runs to
+ * minrun items with binary insertion, and merges runs of similar length, galloping
+ * through long stretches from one run. Sorted or reversed input costs n - 1
+ * comparisons; a few items out of place cost little more.
+ */
+void pylist_sort(struct pylist *self, pylist_cmp cmp) {
+    struct sortstate st = {cmp ? cmp : cmp_text, NULL, 0, MIN_GALLOP, 0, {{NULL, 0}}};
+    char **a = self->items;
+    int left = self->count, minrun = min_run(self->count);
+    TRACE("[pylist_sort] Sorting %d items of pylist@%p, minrun=%d\n", self->count, (void*)self, minrun);
+    if (left < 2) return;
+    while (left > 0) {
+        int n = count_run(&st, a, left);
+        if (n < minrun) {
+            int force = left < minrun ? left : minrun;
+            binary_insertion(&st, a, force, n);
+            n = force;
+        }
+        TRACE("  [pylist_sort] run of %d items at index %d\n", n, (int)(a - self->items));
+        st.runs[st.nruns].base = a;
+        st.runs[st.nruns++].len = n;
+        merge_collapse(&st);
+        a += n;
+        left -= n;
+    }
+    while (st.nruns > 1) {
+        int i = st.nruns - 2;
+        if (i > 0 && st.runs[i - 1].len < st.runs[i + 1].len) --i;
+        merge_at(&st, i);
+    }
+    free(st.tmp);
+}
+
+/**
+ * In a list sorted by cmp (NULL: strcmp): the first index whose item is not less than
+ * text (bisect_left), or the first whose item is greater (bisect_right). O(log n).
+ */
+int pylist_bisect_left(const struct pylist *self, const char *text, pylist_cmp cmp) {
+    int lo = 0, hi = self->count;
+    if (!cmp) cmp = cmp_text;
+    while (lo < hi) {
+        int m = lo + (hi - lo) / 2;
+        if (cmp(self->items[m], text) < 0) lo = m + 1;
+        else hi = m;
+    }
+    return lo;
+}
+
+int pylist_bisect_right(const struct pylist *self, const char *text, pylist_cmp cmp) {
+    int lo = 0, hi = self->count;
+    if (!cmp) cmp = cmp_text;
+    while (lo < hi) {
+        int m = lo + (hi - lo) / 2;
+        if (cmp(text, self->items[m]) < 0) hi = m;
+        else lo = m + 1;
+    }
+    return lo;
+}
+
+/**
+ * Inserts a copy of text into a sorted list, after any equal items (like bisect.insort).
+ */
+void pylist_insort(struct pylist *self, const char *text, pylist_cmp cmp) {
+    pylist_insert(self, pylist_bisect_right(self, text, cmp), text);
+}
+
+/**
+ * pylist_index() for a sorted list: binary search instead of a scan.
+ */
+int pylist_index_sorted(const struct pylist *self, const char *text, pylist_cmp cmp) {
+    int i = pylist_bisect_left(self, text, cmp);
+    if (!cmp) cmp = cmp_text;
+    return i < self->count && cmp(self->items[i], text) == 0 ? i : -1;
+}
+
+/* ---------- Benchmark ---------- */
+
+// The first version of pylist, a singly linked list, to compare against
+struct lnode {
+    char *text;
+    struct lnode *next;
+};
+
+struct oldlist {
+    struct lnode *head;
+    struct lnode *tail;
+    int count;
+};
+
+static void old_append(struct oldlist *self, const char *text) {
+    struct lnode *node = malloc(sizeof(struct lnode));
+    if (!node) {
+        fprintf(stderr, "[Error] old_append: malloc failed\n");
+        exit(EXIT_FAILURE);
+    }
+    node->text = dup_text(text);
+    node->next = NULL;
+    if (self->tail) self->tail->next = node;
+    else self->head = node;
+    self->tail = node;
+    self->count++;
+}
+
+static const char *old_get(const struct oldlist *self, int i) {
+    struct lnode *cur = self->head;
+    while (i-- > 0) cur = cur->next;
+    return cur->text;
+}
+
+static void old_free(struct oldlist *self) {
+    struct lnode *cur = self->head, *next;
+    while (cur) {
+        next = cur->next;
+        free(cur->text);
+        free(cur);
+        cur = next;
+    }
+}
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Append, random gets and a full walk, for the array and for the linked list
+void run_bench(int n) {
+    char buf[32];
+    int gets = 1000000, oldgets = 1000;  // a linked-list get walks n / 2 nodes on average
+    unsigned long long rng = 88172645463325252ull;
+    size_t sum = 0, oldsum = 0;
+    trace = 0;
+    printf("pylist benchmark: %d items\n", n);
+    printf("%-32s %14s %14s\n", "operation", "array", "linked");
+
+    double t0 = now_sec();
+    struct pylist *lst = pylist_new();
+    for (int i = 0; i < n; ++i) {
+        snprintf(buf, sizeof buf, "item %d", i);
+        pylist_append(lst, buf);
+    }
+    double t_arr = now_sec() - t0;
+    t0 = now_sec();
+    struct oldlist old = {NULL, NULL, 0};
+    for (int i = 0; i < n; ++i) {
+        snprintf(buf, sizeof buf, "item %d", i);
+        old_append(&old, buf);
+    }
+    printf("%-32s %12.3f s %12.3f s\n", "append", t_arr, now_sec() - t0);
+
+    int *idx = malloc(gets * sizeof(int));
+    for (int i = 0; i < gets; ++i) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        idx[i] = rng % n;
+    }
+    t0 = now_sec();
+    for (int i = 0; i < gets; ++i) sum += strlen(pylist_get(lst, idx[i]));
+    t_arr = now_sec() - t0;
+    t0 = now_sec();
+    for (int i = 0; i < oldgets; ++i) oldsum += strlen(old_get(&old, idx[i]));
+    double t_old = now_sec() - t0;
+    printf("%-32s %11.1f ns %11.0f ns\n", "random get, per item", t_arr * 1e9 / gets, t_old * 1e9 / oldgets);
+    size_t check = 0;
+    for (int i = 0; i < oldgets; ++i) check += strlen(pylist_get(lst, idx[i]));
+    printf("gets %s (%zu bytes read)\n", check == oldsum ? "agree" : "DISAGREE", sum);
+
+    sum = oldsum = 0;
+    t0 = now_sec();
+    for (int i = 0; i < lst->count; ++i) sum += strlen(lst->items[i]);
+    t_arr = now_sec() - t0;
+    t0 = now_sec();
+    for (struct lnode *cur = old.head; cur; cur = cur->next) oldsum += strlen(cur->text);
+    printf("%-32s %12.3f s %12.3f s\n", "walk all items", t_arr, now_sec() - t0);
+    printf("%-32s %12.1f B %12.1f B\n", "list memory per item (no text)",
+           (double)lst->alloc * sizeof(char *) / n, 32.0);  // a 16-byte node takes a 32-byte malloc chunk
+    printf("walks %s\n", sum == oldsum ? "agree" : "DISAGREE");
+
+    t0 = now_sec();
+    for (int i = 0; i < 1000; ++i) {            // the list stays n long, so any n >= 1 works
+        free(pylist_pop(lst, n / 2));
+        pylist_insert(lst, n / 2, "inserted");
+    }
+    printf("%-32s %11.1f us\n", "insert/pop in the middle, each", (now_sec() - t0) * 1e6 / 2000);
+
+    free(idx);
+    pylist_del(lst);
+    old_free(&old);
+}
+
+static long ncmp;                    // comparisons made by cmp_counted()
+
+static int cmp_counted(const char *a, const char *b) {
+    ++ncmp;
+    return strcmp(a, b);
+}
+
+static int cmp_qsort(const void *a, const void *b) {
+    ++ncmp;
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Sorts order[] both ways and prints the times and comparisons per item
+static void time_sort(const char *name, struct pylist *lst, char **order, char **sorted) {
+    int n = lst->count;
+    memcpy(lst->items, order, (size_t)n * sizeof(char *));
+    ncmp = 0;
+    double t0 = now_sec();
+    qsort(lst->items, n, sizeof(char *), cmp_qsort);
+    double t_q = now_sec() - t0;
+    long c_q = ncmp;
+    memcpy(lst->items, order, (size_t)n * sizeof(char *));
+    ncmp = 0;
+    t0 = now_sec();
+    pylist_sort(lst, cmp_counted);
+    double t_s = now_sec() - t0;
+    int ok = memcmp(lst->items, sorted, (size_t)n * sizeof(char *)) == 0;
+    printf("%-28s %9.3f s %6.1f %9.3f s %6.1f %s\n", name, t_q, (double)c_q / n, t_s, (double)ncmp / n, ok ? "" : "  WRONG ORDER");
+}
+
+// pylist_sort() on differently ordered inputs, and lookups in a sorted list
+void run_sort_bench(int n) {
+    char buf[32];
+    unsigned long long rng = 88172645463325252ull;
+    trace = 0;
+    struct pylist *lst = pylist_new();
+    for (int i = 0; i < n; ++i) {
+        snprintf(buf, sizeof buf, "key-%09d", i);    // distinct, and in sorted order
+        pylist_append(lst, buf);
+    }
+    char **sorted = malloc((size_t)n * sizeof(char *)), **order = malloc((size_t)n * sizeof(char *));
+    memcpy(sorted, lst->items, (size_t)n * sizeof(char *));
+#define RAND(k) (rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17, (int)(rng % (unsigned)(k)))
+    printf("pylist_sort benchmark: %d items (comparisons per item after each time)\n", n);
+    printf("%-28s %18s %18s\n", "input", "qsort()", "pylist_sort()");
+
+    memcpy(order, sorted, (size_t)n * sizeof(char *));
+    for (int i = n - 1; i > 0; --i) {
+        int j = RAND(i + 1);
+        char *t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    time_sort("random", lst, order, sorted);
+    time_sort("sorted", lst, sorted, sorted);
+    for (int i = 0; i < n; ++i) order[i] = sorted[n - 1 - i];
+    time_sort("reversed", lst, order, sorted);
+    memcpy(order, sorted, (size_t)n * sizeof(char *));
+    for (int i = 0; i < n / 100; ++i) {
+        int j = RAND(n), k = RAND(n);
+        char *t = order[j]; order[j] = order[k]; order[k] = t;
+    }
+    time_sort("sorted, 1% swapped", lst, order, sorted);
+    // Sorted, then 1% new items appended: take every 100th item out and add them at the end
+    int m = 0;
+    for (int i = 0; i < n; ++i) if (i % 100) order[m++] = sorted[i];
+    for (int i = 0; i < n; i += 100) order[m++] = sorted[i];
+    for (int i = n - n / 100; i < n - 1; ++i) {
+        int j = i + RAND(n - i);
+        char *t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    time_sort("sorted + 1% random at end", lst, order, sorted);
+    for (int i = 0; i < n; ++i) order[i] = sorted[(i % 2 ? n / 2 : 0) + i / 2];
+    time_sort("two interleaved halves", lst, order, sorted);
+    memcpy(lst->items, sorted, (size_t)n * sizeof(char *));
+
+    int lookups = 1000000, scans = 100, found = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < lookups; ++i) found += pylist_index_sorted(lst, sorted[RAND(n)], NULL) >= 0;
+    double t_b = now_sec() - t0;
+    t0 = now_sec();
+    for (int i = 0; i < scans; ++i) found += pylist_index(lst, sorted[RAND(n)]) >= 0;
+    double t_l = now_sec() - t0;
+    printf("membership test, per lookup: pylist_index_sorted() %.0f ns, pylist_index() %.0f ns (%d of %d found)\n",
+           t_b * 1e9 / lookups, t_l * 1e9 / scans, found, lookups + scans);
+    t0 = now_sec();
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(buf, sizeof buf, "key-%09d+", RAND(n));
+        pylist_insort(lst, buf, NULL);
+    }
+    printf("pylist_insort(), per item: %.1f us\n", (now_sec() - t0) * 1e6 / 1000);
+#undef RAND
+    free(order);
+    free(sorted);
+    pylist_del(lst);
+}
+
+int main(int argc, char **argv)
 {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        int n = argc > 2 ? atoi(argv[2]) : 1000000;
+        if (n <= 0) {
+            fprintf(stderr, "[Error] --bench needs a positive number of items\n");
+            return EXIT_FAILURE;
+        }
+        run_bench(n);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-sort") == 0) {
+        int n = argc > 2 ? atoi(argv[2]) : 1000000;
+        if (n <= 0) {
+            fprintf(stderr, "[Error] --bench-sort needs a positive number of items\n");
+            return EXIT_FAILURE;
+        }
+        run_sort_bench(n);
+        return 0;
+    }
+
     setvbuf(stdout, NULL, _IONBF, 0);  /* Internal */
 
     struct pylist * lst = pylist_new();
@@ -117,6 +852,26 @@ int main(void)
     printf("Length = %d\n", pylist_len(lst));
     printf("Brian? %d\n", pylist_index(lst, "Brian"));
     printf("Bob? %d\n", pylist_index(lst, "Bob"));
+
+    printf("lst[1] = '%s', lst[-1] = '%s'\n", pylist_get(lst, 1), pylist_get(lst, -1));
+    pylist_set(lst, 0, "Goodbye world");
+    pylist_insert(lst, 1, "Inserted");
+    pylist_print(lst);
+    char *popped = pylist_pop(lst, -1);
+    printf("Popped '%s'\n", popped);
+    free(popped);
+    struct pylist *part = pylist_slice(lst, 1, 3);
+    pylist_print(part);
+    pylist_extend(lst, part);
+    pylist_print(lst);
+    pylist_del(part);
+
+    pylist_sort(lst, NULL);
+    pylist_print(lst);
+    pylist_insort(lst, "Delta", NULL);
+    pylist_print(lst);
+    printf("bisect_left('Inserted') = %d, index_sorted('Bob') = %d\n",
+           pylist_bisect_left(lst, "Inserted", NULL), pylist_index_sorted(lst, "Bob", NULL));
     pylist_del(lst);
     return 0;
 }
@@ -124,7 +879,11 @@ int main(void)
 /*
 Tutorial Notes:
 - This struct and functions mimic a subset of Python's list class in C.
-- The list is singly linked, with head/tail pointers and a count.
+- The list is an array of pointers with a count and a capacity, like CPython's list.
+- Over-allocating on growth makes append amortized O(1); get and set are O(1).
+- Insert and pop move pointers with memmove, never the strings themselves.
+- Timsort uses the order already in the data: runs, galloping, balanced merges.
+- Binary search on a sorted list turns membership tests from O(n) into O(log n).
 - All memory is managed with malloc/free.
 - This is a foundation for more advanced list types in C.
 */
@@ -6,6 +6,82 @@
  * This program demonstrates a dynamic string type in C, inspired by Python's str class.
  * It features dynamic buffer management, append, and length tracking, with detailed debug output.
  *
+ * Growing the buffer:
+ *   The first version added 10 bytes whenever the buffer was too small. Building a 1 MB
+ *   string out of short pieces then takes about 100,000 reallocs, and each may copy the
+ *   whole string: quadratic work. Here the buffer at least doubles each time it grows,
+ *   so n bytes of appends cost O(n) copying in total (each byte is copied about twice
+ *   on average). pystr_reserve() sets the capacity up front when the final size is known.
+ *
+ * Short strings live inside the struct:
+ *   Most strings are short, and a separate malloc() for their bytes doubled the cost of
+ *   creating and freeing them. A pystr now carries a PYSTR_SMALL-byte buffer of its own,
+ *   and data points at it until the string outgrows it. A new pystr is one allocation.
+ *   (Because data may point into the struct itself, a pystr must not be copied by value.)
+ *
+ * Appending without temporary strings:
+ *   pystr_append_n() copies a pointer + length with memcpy(), so a slice of another
+ *   buffer needs no strlen() and no '\0'. pystr_appendf() formats printf-style straight
+ *   into the spare capacity (vsnprintf() tells how much room it needed; the rare
+ *   overflow grows the buffer and formats again). pystr_join() adds up the lengths of
+ *   all parts first, allocates once, then copies.
+ *
+ * Searching, splitting, replacing, stripping:
+ *   pystr_find(), pystr_count(), pystr_split(), pystr_replace() and pystr_strip() (with
+ *   lstrip / rstrip) work like their Python namesakes. Instead of looking at one byte at
+ *   a time they compare 16 bytes at once with SSE2, or 32 with AVX2 when the CPU has it
+ *   (checked at run time), and use the byte loop only for the last few bytes or on CPUs
+ *   without SSE2. A substring search compares a block with the pattern's first byte and
+ *   the block m - 1 bytes further on with its last byte, and calls memcmp() only where
+ *   both match. pystr_split() returns views (pointer + length) into the string's own
+ *   bytes instead of copies.
+ *
+ * A rope for very large strings:
+ *   Inserting into or deleting from the middle of a flat buffer moves everything after
+ *   that point: O(n) per edit, seconds of memmove() for a few thousand edits on 100 MB.
+ *   A rope (RNode) keeps the text in a balanced binary tree: leaves point at pieces of
+ *   text, and inner nodes record the total length below them, so finding byte i takes
+ *   one step per level. Concatenation hangs one tree into the other at a matching
+ *   height; split walks one path down, cutting it, and rejoins the pieces. Insert is a
+ *   split and two concatenations, delete two splits and one; all are O(log n).
+ *   Leaf text is never changed once written, so a leaf can be cut in two without
+ *   copying: both halves point into the same chunk. Chunks are 64 KB blocks handed out
+ *   by a pool, with a count of the leaves using them; an unused chunk goes back to the
+ *   pool. Nodes come from a free list too. A rope is read without copying through
+ *   rope_iter_next(), which returns its pieces in order, or copied into a pystr with
+ *   rope_flatten().
+ *
+ * Immutable shared strings:
+ *   A pystr can change, so code that keeps one copies it first, and every slice is a
+ *   copy. An istr is the immutable flavour, like the str objects inside CPython: it
+ *   cannot change after istr_new(), so whoever keeps it just takes a reference
+ *   (istr_incref(); atomic, so threads can share strings) and the last istr_decref()
+ *   frees it. A slice is a small header pointing into the bytes of the string that owns
+ *   them, holding a reference so they stay alive. The hash is computed the first time
+ *   it is needed and kept. istr_intern() returns the one shared copy of a text, from a
+ *   table of interned strings, so equal interned strings are the same pointer.
+ *   An idict (a hash table keyed by istr) checks the pointer first, then the cached
+ *   hash, and compares bytes only when the hashes match. Looking up an interned key
+ *   hashes nothing and compares no bytes.
+ *
+ * Tracing:
+ *   Every operation can print what it does. The lines are compiled in only when
+ *   PYSTR_TRACE is 1 (the default, for this tutorial); build with -DPYSTR_TRACE=0
+ *   (make pystr_demo_quiet) to remove them entirely, as a program using pystr as a
+ *   high-volume output buffer would.
+ *
+ * Usage:
+ *   ./pystr_demo              the demo, tracing every step
+ *   ./pystr_demo --bench [N]  N (default 1M) short appends, and 10 * N small strings,
+ *                             against the old 10-bytes-at-a-time version; then N report
+ *                             lines, slices and joined parts, against strlen() + append
+ *   ./pystr_demo --bench-rope [MB] [EDITS]  EDITS (default 2000) inserts and deletes in
+ *                             the middle of MB (default 100) megabytes, rope vs pystr
+ *   ./pystr_demo --bench-ops [MB]  find, count, split, replace and strip on MB (default
+ *                             64) megabytes of text, SIMD against byte loops
+ *   ./pystr_demo --bench-istr [N]  N (default 1M) shares, slices and dict lookups with
+ *                             istr, against copying and hashing the bytes every time
+ *
  * Author: Andrew M.
  * Date: July 2025
  */
@@ -13,63 +89,148 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define PYSTR_SMALL 24       // bytes stored inside the struct (23 characters + '\0')
 
 struct pystr {
-    int length;
-    int alloc; /* the length of *data */
-    char *data;
+    size_t length;
+    size_t alloc;            /* the length of *data */
+    char *data;              /* small, or a malloc()ed buffer once the string outgrows it */
+    char small[PYSTR_SMALL];
 };
 
 typedef struct pystr pystr;
 
+#ifndef PYSTR_TRACE
+#define PYSTR_TRACE 1        // 0 compiles every trace line out
+#endif
+
+static int trace = 1;        // print a line for every step (off in the benchmarks)
+
+#if PYSTR_TRACE
+#define TRACE(...) do { if (trace) printf(__VA_ARGS__); } while (0)
+#else
+#define TRACE(...) ((void)0)
+#endif
+
 /**
- * Allocates a new pystr with a 10-character buffer.
+ * Allocates a new, empty pystr. Its first PYSTR_SMALL - 1 characters need no other buffer.
  */
 pystr *pystr_new() {
-    printf("[pystr_new] Called to create a new pystr object\n");
+    TRACE("[pystr_new] Called to create a new pystr object\n");
     pystr *s = (pystr *)malloc(sizeof(pystr));
     if (!s) {
         fprintf(stderr, "[Error] pystr_new: malloc failed\n");
         exit(EXIT_FAILURE);
     }
     s->length = 0;
-    s->alloc = 10;
-    s->data = (char *)malloc(s->alloc);
-    if (!s->data) {
-        fprintf(stderr, "[Error] pystr_new: malloc for data failed\n");
-        free(s);
-        exit(EXIT_FAILURE);
-    }
+    s->alloc = PYSTR_SMALL;
+    s->data = s->small;
     s->data[0] = '\0';
-    printf("[pystr_new] pystr struct allocated at %p\n", (void*)s);
-    printf("[pystr_new] data buffer allocated at %p (alloc=%d)\n", (void*)s->data, s->alloc);
+    TRACE("[pystr_new] pystr struct allocated at %p\n", (void*)s);
+    TRACE("[pystr_new] data buffer is the struct's own small buffer at %p (alloc=%zu)\n", (void*)s->data, s->alloc);
     return s;
 }
 
+/**
+ * Makes room for at least n characters (plus the '\0'). The buffer at least doubles when
+ * it grows, so a long run of appends reallocates only O(log n) times.
+ */
+void pystr_reserve(pystr *s, size_t n) {
+    if (n + 1 <= s->alloc) return;
+    size_t newalloc = s->alloc * 2;
+    if (newalloc < n + 1) newalloc = n + 1;
+    TRACE("[pystr_reserve] Buffer too small, growing from %zu to %zu bytes\n", s->alloc, newalloc);
+    char *newdata;
+    if (s->data == s->small) {
+        // Leaving the small buffer: copy its bytes out once
+        newdata = (char *)malloc(newalloc);
+        if (newdata) memcpy(newdata, s->small, s->length + 1);
+    } else {
+        newdata = (char *)realloc(s->data, newalloc);
+    }
+    if (!newdata) {
+        fprintf(stderr, "[Error] pystr_reserve: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    TRACE("[pystr_reserve] Buffer now at %p\n", (void*)newdata);
+    s->data = newdata;
+    s->alloc = newalloc;
+}
+
+/**
+ * Appends the n bytes at p (which need not end in '\0'), expanding buffer as needed.
+ */
+void pystr_append_n(pystr *s, const char *p, size_t n) {
+    TRACE("[pystr_append_n] Called with %zu bytes '%.*s'\n", n, (int)n, p);
+    pystr_reserve(s, s->length + n);
+    memcpy(s->data + s->length, p, n);
+    s->length += n;
+    s->data[s->length] = '\0';
+}
+
 /**
  * Appends a C string to the pystr, expanding buffer as needed.
  */
 void pystr_append(pystr *s, const char *suffix) {
-    printf("[pystr_append] Called with suffix='%s'\n", suffix);
-    printf("[pystr_append] Current length=%d, alloc=%d, data='%s'\n", s->length, s->alloc, s->data);
-    int addlen = strlen(suffix);
-    int newlen = s->length + addlen;
-    if (newlen + 1 > s->alloc) {
-        int newalloc = s->alloc;
-        while (newlen + 1 > newalloc) newalloc += 10;
-        printf("[pystr_append] Buffer too small, reallocating from %d to %d bytes\n", s->alloc, newalloc);
-        char *newdata = (char *)realloc(s->data, newalloc);
-        if (!newdata) {
-            fprintf(stderr, "[Error] pystr_append: realloc failed\n");
-            exit(EXIT_FAILURE);
+    TRACE("[pystr_append] Called with suffix='%s'\n", suffix);
+    TRACE("[pystr_append] Current length=%zu, alloc=%zu, data='%s'\n", s->length, s->alloc, s->data);
+    size_t addlen = strlen(suffix);
+    pystr_reserve(s, s->length + addlen);
+    memcpy(s->data + s->length, suffix, addlen + 1);
+    s->length += addlen;
+    TRACE("[pystr_append] After append: length=%zu, alloc=%zu, data='%s'\n", s->length, s->alloc, s->data);
+}
+
+/**
+ * Appends printf-style formatted text, written straight into the spare capacity.
+ */
+void pystr_appendf(pystr *s, const char *fmt, ...) {
+    va_list ap, again;
+    va_start(ap, fmt);
+    va_copy(again, ap);
+    size_t room = s->alloc - s->length;
+    int n = vsnprintf(s->data + s->length, room, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        fprintf(stderr, "[Error] pystr_appendf: bad format '%s'\n", fmt);
+        exit(EXIT_FAILURE);
+    }
+    if ((size_t)n >= room) {
+        // It did not fit (the part written was cut short): grow, then format again
+        pystr_reserve(s, s->length + n);
+        vsnprintf(s->data + s->length, n + 1, fmt, again);
+    }
+    va_end(again);
+    s->length += n;
+    TRACE("[pystr_appendf] Appended %d bytes, length=%zu, alloc=%zu\n", n, s->length, s->alloc);
+}
+
+/**
+ * Returns a new pystr with the n parts joined by sep, like Python's sep.join(parts).
+ * The total length is added up first, so the buffer is allocated once.
+ */
+pystr *pystr_join(const char *sep, const char *const *parts, size_t n) {
+    size_t seplen = strlen(sep), total = n > 0 ? seplen * (n - 1) : 0;
+    for (size_t i = 0; i < n; ++i) total += strlen(parts[i]);
+    TRACE("[pystr_join] Joining %zu parts, %zu bytes in all\n", n, total);
+    pystr *s = pystr_new();
+    pystr_reserve(s, total);
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0) {
+            memcpy(s->data + s->length, sep, seplen);
+            s->length += seplen;
         }
-        printf("[pystr_append] Buffer reallocated at %p\n", (void*)newdata);
-        s->data = newdata;
-        s->alloc = newalloc;
+        size_t len = strlen(parts[i]);
+        memcpy(s->data + s->length, parts[i], len);
+        s->length += len;
     }
-    strcpy(s->data + s->length, suffix);
-    s->length = newlen;
-    printf("[pystr_append] After append: length=%d, alloc=%d, data='%s'\n", s->length, s->alloc, s->data);
+    s->data[s->length] = '\0';
+    return s;
 }
 
 /**
@@ -77,10 +238,12 @@ void pystr_append(pystr *s, const char *suffix) {
  */
 void pystr_free(pystr *s) {
     if (s) {
-        printf("[pystr_free] Called for pystr@%p\n", (void*)s);
-        printf("[pystr_free] Freeing data buffer at %p\n", (void*)s->data);
-        free(s->data);
-        printf("[pystr_free] Freeing pystr struct at %p\n", (void*)s);
+        TRACE("[pystr_free] Called for pystr@%p\n", (void*)s);
+        if (s->data != s->small) {
+            TRACE("[pystr_free] Freeing data buffer at %p\n", (void*)s->data);
+            free(s->data);
+        }
+        TRACE("[pystr_free] Freeing pystr struct at %p\n", (void*)s);
         free(s);
     }
 }
@@ -90,13 +253,1354 @@ void pystr_free(pystr *s) {
  */
 void pystr_dump(const pystr *s) {
     printf("[pystr_dump] pystr@%p\n", (void*)s);
-    printf("            |-- length = %d\n", s->length);
-    printf("            |-- alloc  = %d\n", s->alloc);
+    printf("            |-- length = %zu\n", s->length);
+    printf("            |-- alloc  = %zu\n", s->alloc);
     printf("            |-- data   = '%s'\n", s->data);
-    printf("            |-- data buffer address = %p\n", (void*)s->data);
+    printf("            |-- data buffer address = %p%s\n", (void*)s->data, s->data == s->small ? " (small, inside the struct)" : "");
+}
+
+/* ---------- Search, split, replace, strip ---------- */
+
+typedef struct pyview {      // a piece of another string's bytes: not a copy, no '\0'
+    const char *data;
+    size_t length;
+} pyview;
+
+static int is_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Byte-at-a-time versions: the fallback without SSE2, and the benchmark baseline
+static const char *find_byte_scalar(const char *p, size_t n, char c) {
+    for (size_t i = 0; i < n; ++i)
+        if (p[i] == c) return p + i;
+    return NULL;
+}
+
+static const char *find_sub_scalar(const char *p, size_t n, const char *sub, size_t m) {
+    for (size_t i = 0; i + m <= n; ++i)
+        if (p[i] == sub[0] && memcmp(p + i, sub, m) == 0) return p + i;
+    return NULL;
+}
+
+static size_t count_byte_scalar(const char *p, size_t n, char c) {
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) k += p[i] == c;
+    return k;
+}
+
+static size_t skip_space_scalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && is_space(p[i])) ++i;
+    return i;
+}
+
+static size_t skip_space_back_scalar(const char *p, size_t n) {
+    size_t i = n;
+    while (i > 0 && is_space(p[i - 1])) --i;
+    return n - i;
+}
+
+#ifdef __SSE2__
+#include <immintrin.h>
+
+/*
+ * 16 bytes (32 with AVX2) are compared at once; movemask turns the result into one bit
+ * per byte, and the lowest set bit is the first match. Substring search compares the
+ * block with the first byte of the pattern and the block m - 1 further on with its last
+ * byte: only positions where both match are checked with memcmp().
+ */
+static const char *find_byte_sse2(const char *p, size_t n, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), needle));
+        if (mask) return p + i + __builtin_ctz(mask);
+    }
+    return find_byte_scalar(p + i, n - i, c);
+}
+
+static const char *find_sub_sse2(const char *p, size_t n, const char *sub, size_t m) {
+    __m128i first = _mm_set1_epi8(sub[0]), last = _mm_set1_epi8(sub[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), first);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i + m - 1)), last);
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(a, b));
+        while (mask) {
+            size_t j = i + __builtin_ctz(mask);
+            if (memcmp(p + j + 1, sub + 1, m - 1) == 0) return p + j;
+            mask &= mask - 1;
+        }
+    }
+    return find_sub_scalar(p + i, n - i, sub, m);
+}
+
+static size_t count_byte_sse2(const char *p, size_t n, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0, k = 0;
+    for (; i + 16 <= n; i += 16)
+        k += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), needle)));
+    return k + count_byte_scalar(p + i, n - i, c);
+}
+
+// One bit per whitespace byte: ' ', or '\t' to '\r' (bytes >= 0x80 compare as negative)
+static unsigned space_mask_sse2(__m128i x) {
+    __m128i sp = _mm_cmpeq_epi8(x, _mm_set1_epi8(' '));
+    __m128i ctl = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('\t' - 1)), _mm_cmplt_epi8(x, _mm_set1_epi8('\r' + 1)));
+    return _mm_movemask_epi8(_mm_or_si128(sp, ctl));
+}
+
+static size_t skip_space_sse2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned mask = space_mask_sse2(_mm_loadu_si128((const __m128i *)(p + i))) ^ 0xFFFF;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + skip_space_scalar(p + i, n - i);
+}
+
+static size_t skip_space_back_sse2(const char *p, size_t n) {
+    size_t i = n;
+    for (; i >= 16; i -= 16) {
+        unsigned mask = space_mask_sse2(_mm_loadu_si128((const __m128i *)(p + i - 16))) ^ 0xFFFF;
+        if (mask) return n - i + __builtin_clz(mask) - 16;
+    }
+    return n - i + skip_space_back_scalar(p, i);
+}
+
+__attribute__((target("avx2")))
+static const char *find_byte_avx2(const char *p, size_t n, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), needle));
+        if (mask) return p + i + __builtin_ctz(mask);
+    }
+    return find_byte_sse2(p + i, n - i, c);
+}
+
+__attribute__((target("avx2")))
+static const char *find_sub_avx2(const char *p, size_t n, const char *sub, size_t m) {
+    __m256i first = _mm256_set1_epi8(sub[0]), last = _mm256_set1_epi8(sub[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), first);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i + m - 1)), last);
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(a, b));
+        while (mask) {
+            size_t j = i + __builtin_ctz(mask);
+            if (memcmp(p + j + 1, sub + 1, m - 1) == 0) return p + j;
+            mask &= mask - 1;
+        }
+    }
+    return find_sub_sse2(p + i, n - i, sub, m);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t count_byte_avx2(const char *p, size_t n, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0, k = 0;
+    for (; i + 32 <= n; i += 32)
+        k += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + i)), needle)));
+    return k + count_byte_sse2(p + i, n - i, c);
+}
+#endif
+
+static int use_simd = 1;     // 0: byte loops everywhere (the benchmark baseline)
+
+// The fastest version this CPU runs
+static const char *find_byte(const char *p, size_t n, char c) {
+    if (!use_simd) return find_byte_scalar(p, n, c);
+#ifdef __SSE2__
+    if (__builtin_cpu_supports("avx2")) return find_byte_avx2(p, n, c);
+    return find_byte_sse2(p, n, c);
+#else
+    return find_byte_scalar(p, n, c);
+#endif
+}
+
+static const char *find_sub(const char *p, size_t n, const char *sub, size_t m) {
+    if (m == 1) return find_byte(p, n, sub[0]);
+    if (!use_simd) return find_sub_scalar(p, n, sub, m);
+#ifdef __SSE2__
+    if (__builtin_cpu_supports("avx2")) return find_sub_avx2(p, n, sub, m);
+    return find_sub_sse2(p, n, sub, m);
+#else
+    return find_sub_scalar(p, n, sub, m);
+#endif
+}
+
+static size_t count_byte(const char *p, size_t n, char c) {
+    if (!use_simd) return count_byte_scalar(p, n, c);
+#ifdef __SSE2__
+    if (__builtin_cpu_supports("avx2")) return count_byte_avx2(p, n, c);
+    return count_byte_sse2(p, n, c);
+#else
+    return count_byte_scalar(p, n, c);
+#endif
+}
+
+static size_t skip_space(const char *p, size_t n) {
+    if (!use_simd) return skip_space_scalar(p, n);
+#ifdef __SSE2__
+    return skip_space_sse2(p, n);
+#else
+    return skip_space_scalar(p, n);
+#endif
+}
+
+static size_t skip_space_back(const char *p, size_t n) {
+    if (!use_simd) return skip_space_back_scalar(p, n);
+#ifdef __SSE2__
+    return skip_space_back_sse2(p, n);
+#else
+    return skip_space_back_scalar(p, n);
+#endif
+}
+
+/**
+ * Index of the first sub[0..m) in s, or -1 (like Python's str.find). An empty sub is at 0.
+ */
+long pystr_find(const pystr *s, const char *sub, size_t m) {
+    if (m == 0) return 0;
+    if (m > s->length) return -1;
+    const char *r = find_sub(s->data, s->length, sub, m);
+    TRACE("[pystr_find] '%.*s' %s\n", (int)m, sub, r ? "found" : "not found");
+    return r ? (long)(r - s->data) : -1;
+}
+
+/**
+ * Number of non-overlapping sub[0..m) in s (like str.count; an empty sub counts length + 1).
+ */
+size_t pystr_count(const pystr *s, const char *sub, size_t m) {
+    if (m == 0) return s->length + 1;
+    if (m == 1) return count_byte(s->data, s->length, sub[0]);
+    size_t k = 0;
+    const char *p = s->data, *end = s->data + s->length, *r;
+    while ((size_t)(end - p) >= m && (r = find_sub(p, end - p, sub, m)) != NULL) {
+        ++k;
+        p = r + m;
+    }
+    return k;
+}
+
+/**
+ * Splits s at every sep[0..m) (m >= 1) into *count views of s's own bytes, returned in
+ * a malloc()ed array: no text is copied. The views are valid while s is not changed.
+ */
+pyview *pystr_split(const pystr *s, const char *sep, size_t m, size_t *count) {
+    if (m == 0) {
+        fprintf(stderr, "[Error] pystr_split: empty separator\n");
+        *count = 0;
+        return NULL;
+    }
+    size_t cap = 16, k = 0;
+    pyview *v = (pyview *)malloc(cap * sizeof(pyview));
+    const char *p = s->data, *end = s->data + s->length, *r;
+    for (;;) {
+        r = (size_t)(end - p) >= m ? find_sub(p, end - p, sep, m) : NULL;
+        if (k == cap) {
+            cap *= 2;
+            v = (pyview *)realloc(v, cap * sizeof(pyview));
+        }
+        if (v == NULL) {
+            fprintf(stderr, "[Error] pystr_split: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        v[k].data = p;
+        v[k++].length = (r ? r : end) - p;
+        if (r == NULL) break;
+        p = r + m;
+    }
+    TRACE("[pystr_split] '%.*s' split into %zu views\n", (int)m, sep, k);
+    *count = k;
+    return v;
+}
+
+pyview *pystr_split_char(const pystr *s, char sep, size_t *count) {
+    return pystr_split(s, &sep, 1, count);
+}
+
+/**
+ * New pystr with every old[0..oldn) replaced by repl[0..repln). The matches are counted
+ * first, so the result is allocated once at its final size.
+ */
+pystr *pystr_replace(const pystr *s, const char *old, size_t oldn, const char *repl, size_t repln) {
+    size_t k = pystr_count(s, old, oldn);
+    pystr *out = pystr_new();
+    pystr_reserve(out, s->length + k * repln - k * oldn);
+    const char *p = s->data, *end = s->data + s->length, *r;
+    char *dst = out->data;
+    if (oldn == 0) {
+        // As in Python: repl goes before every character and at the end
+        for (; p < end; ++p) {
+            memcpy(dst, repl, repln);
+            dst += repln;
+            *dst++ = *p;
+        }
+    } else {
+        for (size_t i = 0; i < k; ++i) {
+            r = find_sub(p, end - p, old, oldn);
+            memcpy(dst, p, r - p);
+            dst += r - p;
+            memcpy(dst, repl, repln);
+            dst += repln;
+            p = r + oldn;
+        }
+    }
+    memcpy(dst, p, end - p);
+    dst += end - p;
+    if (oldn == 0) {
+        memcpy(dst, repl, repln);
+        dst += repln;
+    }
+    *dst = '\0';
+    out->length = dst - out->data;
+    TRACE("[pystr_replace] %zu replacements, %zu -> %zu bytes\n", k, s->length, out->length);
+    return out;
+}
+
+/**
+ * Removes leading / trailing / both whitespace in place, scanning 16 bytes at a time.
+ */
+void pystr_rstrip(pystr *s) {
+    s->length -= skip_space_back(s->data, s->length);
+    s->data[s->length] = '\0';
+    TRACE("[pystr_rstrip] length now %zu\n", s->length);
+}
+
+void pystr_lstrip(pystr *s) {
+    size_t k = skip_space(s->data, s->length);
+    memmove(s->data, s->data + k, s->length - k + 1);
+    s->length -= k;
+    TRACE("[pystr_lstrip] removed %zu bytes, length now %zu\n", k, s->length);
+}
+
+void pystr_strip(pystr *s) {
+    pystr_rstrip(s);
+    pystr_lstrip(s);
+}
+
+/* ---------- Rope ---------- */
+
+#define ROPE_CHUNK 65536         // bytes per pool chunk
+#define ROPE_LEAF 4096           // longest leaf made from new text
+#define ROPE_MAX_HEIGHT 64       // an AVL tree this tall would need more than 2^44 leaves
+#define ROPE_SLAB 1024           // nodes allocated at a time
+
+struct chunk {               // pool memory for rope text: filled once, then never changed
+    struct chunk *next;      // in the free list
+    size_t used;             // bytes handed out so far
+    int refs;                // leaves pointing into it
+    char bytes[ROPE_CHUNK];
+};
+
+typedef struct rnode {
+    struct rnode *left, *right;  // both NULL for a leaf
+    size_t length;           // bytes in this subtree
+    int height;              // a leaf is 1
+    struct chunk *chunk;     // leaf: the chunk holding its bytes
+    const char *data;        // leaf: its bytes (inside chunk)
+} RNode;
+
+static struct chunk *open_chunk;     // where new text goes
+static struct chunk *free_chunks;    // chunks no leaf uses any more
+static RNode *free_nodes;            // nodes ready for reuse
+
+static RNode *rnode_alloc() {
+    if (free_nodes == NULL) {
+        RNode *slab = (RNode *)malloc(ROPE_SLAB * sizeof(RNode));
+        if (slab == NULL) {
+            fprintf(stderr, "[Error] rope: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < ROPE_SLAB; ++i) {
+            slab[i].left = free_nodes;
+            free_nodes = &slab[i];
+        }
+    }
+    RNode *n = free_nodes;
+    free_nodes = n->left;
+    return n;
+}
+
+static void rnode_release(RNode *n) {
+    n->left = free_nodes;
+    free_nodes = n;
+}
+
+static void chunk_unref(struct chunk *c) {
+    if (--c->refs > 0) return;
+    if (c == open_chunk) {
+        c->used = 0;                 // nothing points into it: start it over
+    } else {
+        c->next = free_chunks;
+        free_chunks = c;
+    }
+}
+
+static RNode *rope_leaf(struct chunk *c, const char *data, size_t len) {
+    RNode *n = rnode_alloc();
+    n->left = n->right = NULL;
+    n->length = len;
+    n->height = 1;
+    n->chunk = c;
+    n->data = data;
+    c->refs++;
+    return n;
+}
+
+static int rheight(const RNode *n) {
+    return n ? n->height : 0;
+}
+
+static RNode *rfix(RNode *n) {
+    n->length = n->left->length + n->right->length;
+    n->height = 1 + (rheight(n->left) > rheight(n->right) ? rheight(n->left) : rheight(n->right));
+    return n;
+}
+
+static RNode *rotate_right(RNode *n) {
+    RNode *l = n->left;
+    n->left = l->right;
+    l->right = rfix(n);
+    return rfix(l);
+}
+
+static RNode *rotate_left(RNode *n) {
+    RNode *r = n->right;
+    n->right = r->left;
+    r->left = rfix(n);
+    return rfix(r);
+}
+
+// Restores the AVL balance of n after one side changed height by at most 2
+static RNode *rebalance(RNode *n) {
+    rfix(n);
+    if (rheight(n->left) > rheight(n->right) + 1) {
+        if (rheight(n->left->left) < rheight(n->left->right)) n->left = rotate_left(n->left);
+        return rotate_right(n);
+    }
+    if (rheight(n->right) > rheight(n->left) + 1) {
+        if (rheight(n->right->right) < rheight(n->right->left)) n->right = rotate_right(n->right);
+        return rotate_left(n);
+    }
+    return n;
+}
+
+/**
+ * Concatenates two ropes (both are used up). The shorter tree is hung into the taller
+ * one's edge at a matching height, so this costs O(|height(a) - height(b)|).
+ */
+RNode *rope_concat(RNode *a, RNode *b) {
+    if (a == NULL) return b;
+    if (b == NULL) return a;
+    if (a->height > b->height + 1) {
+        a->right = rope_concat(a->right, b);
+        return rebalance(a);
+    }
+    if (b->height > a->height + 1) {
+        b->left = rope_concat(a, b->left);
+        return rebalance(b);
+    }
+    RNode *n = rnode_alloc();
+    n->left = a;
+    n->right = b;
+    n->chunk = NULL;
+    n->data = NULL;
+    return rfix(n);
+}
+
+/**
+ * Splits rope t (used up) into its first pos bytes and the rest. A leaf that straddles
+ * pos becomes two leaves over the same chunk: no bytes are copied. O(log n).
+ */
+void rope_split(RNode *t, size_t pos, RNode **left, RNode **right) {
+    if (t == NULL || pos == 0) {
+        *left = NULL;
+        *right = t;
+    } else if (pos >= t->length) {
+        *left = t;
+        *right = NULL;
+    } else if (t->left == NULL) {
+        *left = rope_leaf(t->chunk, t->data, pos);
+        *right = rope_leaf(t->chunk, t->data + pos, t->length - pos);
+        chunk_unref(t->chunk);
+        rnode_release(t);
+    } else {
+        RNode *l = t->left, *r = t->right, *a, *b;
+        size_t llen = l->length;
+        rnode_release(t);
+        if (pos < llen) {
+            rope_split(l, pos, &a, &b);
+            *left = a;
+            *right = rope_concat(b, r);
+        } else {
+            rope_split(r, pos - llen, &a, &b);
+            *left = rope_concat(l, a);
+            *right = b;
+        }
+    }
+}
+
+/**
+ * Makes a rope of a copy of p[0..n): the bytes go into pool chunks, at most ROPE_LEAF
+ * per leaf, and the leaves are joined into a balanced tree.
+ */
+RNode *rope_from(const char *p, size_t n) {
+    RNode *t = NULL;
+    while (n > 0) {
+        if (open_chunk == NULL || open_chunk->used == ROPE_CHUNK) {
+            if (open_chunk && open_chunk->refs == 0) {
+                open_chunk->used = 0;                // full, but nothing uses it
+            } else {
+                struct chunk *c = free_chunks;
+                if (c) free_chunks = c->next;
+                else if ((c = (struct chunk *)malloc(sizeof(struct chunk))) == NULL) {
+                    fprintf(stderr, "[Error] rope: out of memory\n");
+                    exit(EXIT_FAILURE);
+                }
+                c->used = 0;
+                c->refs = 0;
+                if (open_chunk && open_chunk->refs == 0) {
+                    open_chunk->next = free_chunks;
+                    free_chunks = open_chunk;
+                }
+                open_chunk = c;
+            }
+        }
+        size_t take = ROPE_CHUNK - open_chunk->used;
+        if (take > ROPE_LEAF) take = ROPE_LEAF;
+        if (take > n) take = n;
+        char *dst = open_chunk->bytes + open_chunk->used;
+        memcpy(dst, p, take);
+        open_chunk->used += take;
+        t = rope_concat(t, rope_leaf(open_chunk, dst, take));
+        p += take;
+        n -= take;
+    }
+    return t;
+}
+
+size_t rope_length(const RNode *t) {
+    return t ? t->length : 0;
+}
+
+/**
+ * Inserts a copy of p[0..n) at pos: split, then two concatenations.
+ */
+RNode *rope_insert(RNode *t, size_t pos, const char *p, size_t n) {
+    RNode *a, *b;
+    TRACE("[rope_insert] %zu bytes at %zu in a rope of %zu\n", n, pos, rope_length(t));
+    rope_split(t, pos, &a, &b);
+    return rope_concat(rope_concat(a, rope_from(p, n)), b);
+}
+
+void rope_free(RNode *t) {
+    RNode *stack[ROPE_MAX_HEIGHT];
+    int sp = 0;
+    if (t) stack[sp++] = t;
+    while (sp > 0) {
+        RNode *n = stack[--sp];
+        if (n->left) {
+            stack[sp++] = n->left;
+            stack[sp++] = n->right;
+        } else {
+            chunk_unref(n->chunk);
+        }
+        rnode_release(n);
+    }
+}
+
+/**
+ * Deletes n bytes at pos: two splits, then one concatenation.
+ */
+RNode *rope_delete(RNode *t, size_t pos, size_t n) {
+    RNode *a, *b, *c;
+    TRACE("[rope_delete] %zu bytes at %zu from a rope of %zu\n", n, pos, rope_length(t));
+    rope_split(t, pos, &a, &b);
+    rope_split(b, n, &b, &c);
+    rope_free(b);
+    return rope_concat(a, c);
+}
+
+/**
+ * Byte i of the rope: one step down per level.
+ */
+char rope_index(const RNode *t, size_t i) {
+    while (t->left) {
+        if (i < t->left->length) {
+            t = t->left;
+        } else {
+            i -= t->left->length;
+            t = t->right;
+        }
+    }
+    return t->data[i];
+}
+
+struct rope_iter {           // walks the leaves in order, with the path kept on a stack
+    const RNode *stack[ROPE_MAX_HEIGHT];
+    int sp;
+};
+
+void rope_iter_init(struct rope_iter *it, const RNode *t) {
+    it->sp = 0;
+    if (t) it->stack[it->sp++] = t;
+}
+
+/**
+ * Sets *p and *n to the next piece of the rope's text, in place in its chunk (no copy).
+ * Returns 0 after the last piece.
+ */
+int rope_iter_next(struct rope_iter *it, const char **p, size_t *n) {
+    while (it->sp > 0) {
+        const RNode *t = it->stack[--it->sp];
+        if (t->left == NULL) {
+            *p = t->data;
+            *n = t->length;
+            return 1;
+        }
+        it->stack[it->sp++] = t->right;
+        it->stack[it->sp++] = t->left;
+    }
+    return 0;
+}
+
+/**
+ * Writes the rope to f one piece at a time, straight from the chunks.
+ */
+size_t rope_write(const RNode *t, FILE *f) {
+    struct rope_iter it;
+    const char *p;
+    size_t n, total = 0;
+    rope_iter_init(&it, t);
+    while (rope_iter_next(&it, &p, &n)) total += fwrite(p, 1, n, f);
+    return total;
+}
+
+/**
+ * Copies the rope into a new pystr: one allocation, then one memcpy per piece.
+ */
+pystr *rope_flatten(const RNode *t) {
+    struct rope_iter it;
+    const char *p;
+    size_t n;
+    TRACE("[rope_flatten] Copying %zu bytes into a new pystr\n", rope_length(t));
+    pystr *s = pystr_new();
+    pystr_reserve(s, rope_length(t));
+    rope_iter_init(&it, t);
+    while (rope_iter_next(&it, &p, &n)) {
+        memcpy(s->data + s->length, p, n);
+        s->length += n;
+    }
+    s->data[s->length] = '\0';
+    return s;
+}
+
+/* ---------- Immutable shared strings ---------- */
+
+typedef struct istr {        // never changes after creation, so it can be shared freely
+    _Atomic long refs;
+    _Atomic size_t hash;     // 0 until istr_hash() first runs
+    size_t length;
+    const char *data;        // bytes (own, or the parent's for a slice); no '\0' for slices
+    struct istr *base;       // slice: the string that owns the bytes, kept alive
+    unsigned interned;       // intern table generation this string belongs to, 0 if none
+    char bytes[];            // own bytes + '\0' (not used by slices)
+} istr;
+
+static istr *istr_alloc(size_t extra) {
+    istr *s = (istr *)malloc(sizeof(istr) + extra);
+    if (!s) {
+        fprintf(stderr, "[Error] istr: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(&s->refs, 1);
+    atomic_init(&s->hash, 0);
+    s->base = NULL;
+    s->interned = 0;
+    return s;
+}
+
+/**
+ * New immutable string holding a copy of p[0..n), in one allocation with its header.
+ */
+istr *istr_new(const char *p, size_t n) {
+    istr *s = istr_alloc(n + 1);
+    memcpy(s->bytes, p, n);
+    s->bytes[n] = '\0';
+    s->data = s->bytes;
+    s->length = n;
+    TRACE("[istr_new] istr@%p '%.*s'\n", (void*)s, (int)n, p);
+    return s;
+}
+
+istr *istr_from_pystr(const pystr *ps) {
+    return istr_new(ps->data, ps->length);
+}
+
+/**
+ * Sharing is a reference count increment instead of a copy.
+ */
+istr *istr_incref(istr *s) {
+    atomic_fetch_add_explicit(&s->refs, 1, memory_order_relaxed);
+    return s;
+}
+
+void istr_decref(istr *s) {
+    if (atomic_fetch_sub_explicit(&s->refs, 1, memory_order_acq_rel) != 1) return;
+    TRACE("[istr_decref] Last reference gone, freeing istr@%p\n", (void*)s);
+    if (s->base) istr_decref(s->base);
+    free(s);
+}
+
+/**
+ * s[start:stop] (clamped) without copying: the slice points into the bytes of the
+ * string that owns them and holds a reference to it.
+ */
+istr *istr_slice(istr *s, size_t start, size_t stop) {
+    if (stop > s->length) stop = s->length;
+    if (start > stop) start = stop;
+    istr *v = istr_alloc(0);
+    v->base = istr_incref(s->base ? s->base : s);
+    v->data = s->data + start;
+    v->length = stop - start;
+    TRACE("[istr_slice] istr@%p is [%zu:%zu] of istr@%p, sharing its bytes\n", (void*)v, start, stop, (void*)v->base);
+    return v;
+}
+
+/**
+ * FNV-1a, computed on first use and cached: the string cannot change, so neither can its
+ * hash. A real hash of 0 is stored as 1 so that 0 can mean "not computed yet".
+ */
+size_t istr_hash(istr *s) {
+    size_t h = atomic_load_explicit(&s->hash, memory_order_relaxed);
+    if (h) return h;
+    h = 14695981039346656037ull;
+    for (size_t i = 0; i < s->length; ++i) h = (h ^ (unsigned char)s->data[i]) * 1099511628211ull;
+    if (h == 0) h = 1;
+    atomic_store_explicit(&s->hash, h, memory_order_relaxed);
+    return h;
+}
+
+/**
+ * Same pointer is equal; different cached hashes are unequal; only then the bytes.
+ */
+int istr_eq(istr *a, istr *b) {
+    if (a == b) return 1;
+    if (a->length != b->length) return 0;
+    if (istr_hash(a) != istr_hash(b)) return 0;
+    if (a->interned && a->interned == b->interned) return 0;    // one table never holds a text twice
+    return memcmp(a->data, b->data, a->length) == 0;
+}
+
+/* ---------- Interning and dict ---------- */
+
+struct islot {
+    istr *key;               // NULL for an empty slot
+    void *value;
+};
+
+typedef struct idict {       // open addressing, linear probing, at most half full
+    size_t cap, count;
+    struct islot *slots;
+} idict;
+
+idict *idict_new() {
+    idict *d = (idict *)malloc(sizeof(idict));
+    if (!d) {
+        fprintf(stderr, "[Error] idict_new: malloc failed\n");
+        exit(EXIT_FAILURE);
+    }
+    d->cap = 16;
+    d->count = 0;
+    d->slots = (struct islot *)calloc(d->cap, sizeof(struct islot));
+    return d;
+}
+
+// The slot holding key, or the empty slot where it would go
+static struct islot *idict_slot(const idict *d, istr *key) {
+    size_t h = istr_hash(key);
+    for (size_t i = h & (d->cap - 1);; i = (i + 1) & (d->cap - 1)) {
+        struct islot *e = &d->slots[i];
+        if (e->key == NULL || e->key == key) return e;
+        if (istr_hash(e->key) == h && istr_eq(e->key, key)) return e;
+    }
+}
+
+static void idict_grow(idict *d) {
+    struct islot *old = d->slots;
+    size_t oldcap = d->cap;
+    d->cap *= 2;
+    d->slots = (struct islot *)calloc(d->cap, sizeof(struct islot));
+    for (size_t i = 0; i < oldcap; ++i)
+        if (old[i].key) *idict_slot(d, old[i].key) = old[i];
+    free(old);
+}
+
+/**
+ * Sets d[key] = value. The dict keeps its own reference to a new key.
+ */
+void idict_put(idict *d, istr *key, void *value) {
+    if (2 * (d->count + 1) > d->cap) idict_grow(d);
+    struct islot *e = idict_slot(d, key);
+    if (e->key == NULL) {
+        e->key = istr_incref(key);
+        d->count++;
+    }
+    e->value = value;
+}
+
+/**
+ * d[key], or NULL. Keys that are the same object match on the pointer alone.
+ */
+void *idict_get(const idict *d, istr *key) {
+    struct islot *e = idict_slot(d, key);
+    return e->key ? e->value : NULL;
+}
+
+int idict_contains(const idict *d, istr *key) {
+    return idict_slot(d, key)->key != NULL;
+}
+
+void idict_free(idict *d) {
+    for (size_t i = 0; i < d->cap; ++i)
+        if (d->slots[i].key) istr_decref(d->slots[i].key);
+    free(d->slots);
+    free(d);
+}
+
+static idict *interned;                  // the intern table: a set of istr
+static unsigned intern_gen = 1;          // bumped by istr_intern_clear()
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Returns the one shared copy of s's text (a new reference) and releases s. Equal
+ * interned strings are the same object, so comparing them is a pointer comparison.
+ * Interned strings stay alive until istr_intern_clear(); strings interned before a
+ * clear keep their old generation and compare by bytes with the new ones.
+ */
+istr *istr_intern(istr *s) {
+    pthread_mutex_lock(&intern_lock);
+    if (s->interned == intern_gen) {
+        pthread_mutex_unlock(&intern_lock);
+        return s;
+    }
+    if (interned == NULL) interned = idict_new();
+    struct islot *e = idict_slot(interned, s);
+    istr *t = e->key;
+    if (t == NULL) {
+        // The flag is set before anyone else can see t: a string we hold the only
+        // reference to is taken as is, anything else is copied.
+        if (s->base == NULL && atomic_load(&s->refs) == 1) {
+            t = istr_incref(s);
+        } else {
+            t = istr_new(s->data, s->length);    // also: don't keep a whole parent alive for a slice
+        }
+        t->interned = intern_gen;
+        idict_put(interned, t, NULL);
+        istr_decref(t);                          // the table's reference is the one idict_put took
+    }
+    istr_incref(t);
+    pthread_mutex_unlock(&intern_lock);
+    TRACE("[istr_intern] '%.*s' is istr@%p\n", (int)s->length, s->data, (void*)t);
+    istr_decref(s);
+    return t;
+}
+
+void istr_intern_clear() {
+    pthread_mutex_lock(&intern_lock);
+    if (interned) idict_free(interned);
+    interned = NULL;
+    if (++intern_gen == 0) intern_gen = 1;    // 0 means "not interned"
+    pthread_mutex_unlock(&intern_lock);
+}
+
+/* ---------- Benchmark ---------- */
+
+// The first version, without the trace: two allocations, and 10 more bytes per step
+struct oldstr {
+    int length;
+    int alloc;
+    char *data;
+};
+
+static struct oldstr *old_new() {
+    struct oldstr *s = (struct oldstr *)malloc(sizeof(*s));
+    s->length = 0;
+    s->alloc = 10;
+    s->data = (char *)malloc(s->alloc);
+    s->data[0] = '\0';
+    return s;
+}
+
+static void old_append(struct oldstr *s, const char *suffix) {
+    int addlen = strlen(suffix);
+    int newlen = s->length + addlen;
+    if (newlen + 1 > s->alloc) {
+        int newalloc = s->alloc;
+        while (newlen + 1 > newalloc) newalloc += 10;
+        s->data = (char *)realloc(s->data, newalloc);
+        s->alloc = newalloc;
+    }
+    strcpy(s->data + s->length, suffix);
+    s->length = newlen;
+}
+
+static void old_free(struct oldstr *s) {
+    free(s->data);
+    free(s);
+}
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Short pieces of 1 to 8 characters, like tokens of a generated report
+static const char *pieces[] = {"a", "to", "the", "word", "value", "result", "compute", "=3.1415"};
+
+// A report line the way it had to be built before: format into a temporary C string,
+// then pystr_append() measures it again with strlen()
+static size_t run_api_bench(size_t n) {
+    char line[128];
+    size_t sink = 0;
+    const char *text = "The quick brown fox jumps over the lazy dog. ";
+    printf("%-44s %10s   (trace %s)\n", "output buffer", "seconds", PYSTR_TRACE ? "compiled in, switched off" : "compiled out");
+
+    double t0 = now_sec();
+    pystr *s = pystr_new();
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(line, sizeof(line), "id=%zu name=%s value=%.2f\n", i, pieces[i & 7], i * 0.25);
+        pystr_append(s, line);
+    }
+    printf("%-44s %10.3f\n", "N report lines: snprintf + append", now_sec() - t0);
+    sink += s->length;
+    pystr_free(s);
+
+    t0 = now_sec();
+    s = pystr_new();
+    for (size_t i = 0; i < n; ++i) pystr_appendf(s, "id=%zu name=%s value=%.2f\n", i, pieces[i & 7], i * 0.25);
+    printf("%-44s %10.3f\n", "N report lines: pystr_appendf", now_sec() - t0);
+    sink += s->length;
+    pystr_free(s);
+
+    // Slices of a longer text: copied to a temporary C string first, or appended directly
+    t0 = now_sec();
+    s = pystr_new();
+    for (size_t i = 0; i < n; ++i) {
+        size_t at = i % 40, len = 1 + i % 5;
+        memcpy(line, text + at, len);
+        line[len] = '\0';
+        pystr_append(s, line);
+    }
+    printf("%-44s %10.3f\n", "N slices: copy to a C string + append", now_sec() - t0);
+    sink += s->length;
+    pystr_free(s);
+    t0 = now_sec();
+    s = pystr_new();
+    for (size_t i = 0; i < n; ++i) pystr_append_n(s, text + i % 40, 1 + i % 5);
+    printf("%-44s %10.3f\n", "N slices: pystr_append_n", now_sec() - t0);
+    sink += s->length;
+    pystr_free(s);
+
+    // ", ".join() of N parts: appending separator and part, or pystr_join()
+    const char **parts = (const char **)malloc(n * sizeof(*parts));
+    for (size_t i = 0; i < n; ++i) parts[i] = pieces[i & 7];
+    t0 = now_sec();
+    s = pystr_new();
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0) pystr_append(s, ", ");
+        pystr_append(s, parts[i]);
+    }
+    printf("%-44s %10.3f\n", "join N parts: append in a loop", now_sec() - t0);
+    sink += s->length;
+    pystr_free(s);
+    t0 = now_sec();
+    s = pystr_join(", ", parts, n);
+    printf("%-44s %10.3f\n", "join N parts: pystr_join", now_sec() - t0);
+    sink += s->length;
+    pystr_free(s);
+    free(parts);
+    return sink;
+}
+
+void run_bench(size_t n) {
+    size_t sink = 0;
+    trace = 0;
+    printf("%-44s %10s %12s %10s\n", "benchmark", "seconds", "final alloc", "regrowths");
+
+    // Two strings growing side by side, so realloc() cannot always just extend a block
+    size_t grows = 0;
+    double t0 = now_sec();
+    struct oldstr *o = old_new(), *o2 = old_new();
+    for (size_t i = 0; i < n; ++i) {
+        int before = o->alloc;
+        old_append(o, pieces[i & 7]);
+        old_append(o2, pieces[(i + 3) & 7]);
+        grows += o->alloc != before;
+    }
+    printf("%-44s %10.3f %12d %10zu\n", "2 x append, +10 bytes per growth (old)", now_sec() - t0, o->alloc, grows);
+    sink += o->length + o2->length;
+    old_free(o);
+    old_free(o2);
+
+    grows = 0;
+    t0 = now_sec();
+    pystr *s = pystr_new(), *s2 = pystr_new();
+    for (size_t i = 0; i < n; ++i) {
+        size_t before = s->alloc;
+        pystr_append(s, pieces[i & 7]);
+        pystr_append(s2, pieces[(i + 3) & 7]);
+        grows += s->alloc != before;
+    }
+    printf("%-44s %10.3f %12zu %10zu\n", "2 x append, doubling", now_sec() - t0, s->alloc, grows);
+    sink += s->length + s2->length;
+    pystr_free(s);
+    pystr_free(s2);
+
+    t0 = now_sec();
+    s = pystr_new();
+    pystr_reserve(s, n * 8);
+    for (size_t i = 0; i < n; ++i) pystr_append(s, pieces[i & 7]);
+    printf("%-44s %10.3f %12zu %10d\n", "1 x append after pystr_reserve()", now_sec() - t0, s->alloc, 1);
+    sink += s->length;
+    pystr_free(s);
+
+    // Creating, filling and freeing small strings
+    size_t m = n * 10;
+    t0 = now_sec();
+    for (size_t i = 0; i < m; ++i) {
+        o = old_new();
+        old_append(o, pieces[i & 7]);
+        sink += o->length;
+        old_free(o);
+    }
+    printf("%-44s %10.3f\n", "10 x N small strings, 2 mallocs each (old)", now_sec() - t0);
+    t0 = now_sec();
+    for (size_t i = 0; i < m; ++i) {
+        s = pystr_new();
+        pystr_append(s, pieces[i & 7]);
+        sink += s->length;
+        pystr_free(s);
+    }
+    printf("%-44s %10.3f\n", "10 x N small strings, inline buffer", now_sec() - t0);
+
+    // Keeping them alive at once, where the allocation count shows up as memory too
+    m = n;
+    struct oldstr **olds = (struct oldstr **)malloc(m * sizeof(*olds));
+    t0 = now_sec();
+    for (size_t i = 0; i < m; ++i) {
+        olds[i] = old_new();
+        old_append(olds[i], pieces[i & 7]);
+    }
+    for (size_t i = 0; i < m; ++i) old_free(olds[i]);
+    printf("%-44s %10.3f\n", "N live small strings, 2 mallocs each (old)", now_sec() - t0);
+    free(olds);
+    pystr **news = (pystr **)malloc(m * sizeof(*news));
+    t0 = now_sec();
+    for (size_t i = 0; i < m; ++i) {
+        news[i] = pystr_new();
+        pystr_append(news[i], pieces[i & 7]);
+    }
+    for (size_t i = 0; i < m; ++i) pystr_free(news[i]);
+    printf("%-44s %10.3f\n", "N live small strings, inline buffer", now_sec() - t0);
+    free(news);
+    printf("glibc moves big blocks with mremap() instead of copying them, which hides most of\n"
+           "the old version's copying; with other allocators each regrowth copies the string.\n\n");
+    sink += run_api_bench(n);
+    printf("(checksum %zu)\n", sink);
+}
+
+// Runs op on s with SIMD and with byte loops, and prints both times
+static size_t time_op(const char *name, size_t (*op)(pystr *), pystr *s) {
+    size_t r[2];
+    double t[2];
+    for (int simd = 0; simd <= 1; ++simd) {
+        use_simd = simd;
+        double t0 = now_sec();
+        r[simd] = op(s);
+        t[simd] = now_sec() - t0;
+    }
+    printf("%-34s %10.4f %10.4f %8.1fx%s\n", name, t[0], t[1], t[0] / t[1], r[0] == r[1] ? "" : "  RESULTS DIFFER");
+    return r[1];
+}
+
+static size_t op_find_byte(pystr *s) { return pystr_find(s, "#", 1); }
+static size_t op_find_sub(pystr *s) { return pystr_find(s, "quick red fox", 13); }
+static size_t op_count(pystr *s) { return pystr_count(s, "\n", 1); }
+static size_t op_count_sub(pystr *s) { return pystr_count(s, "fox", 3); }
+
+static size_t op_split_char(pystr *s) {
+    size_t n, sum = 0;
+    pyview *v = pystr_split_char(s, '\n', &n);
+    for (size_t i = 0; i < n; i += 1000) sum += v[i].length;
+    free(v);
+    return n + sum;
+}
+
+static size_t op_split_sub(pystr *s) {
+    size_t n, sum = 0;
+    pyview *v = pystr_split(s, ", ", 2, &n);
+    for (size_t i = 0; i < n; i += 1000) sum += v[i].length;
+    free(v);
+    return n + sum;
+}
+
+static size_t op_replace(pystr *s) {
+    pystr *r = pystr_replace(s, "fox", 3, "cat", 3);
+    size_t h = r->length + (unsigned char)r->data[r->length / 2];
+    pystr_free(r);
+    return h;
+}
+
+static size_t op_strip(pystr *s) {
+    size_t n = s->length;
+    pystr *t = pystr_new();
+    pystr_append_n(t, s->data, n);
+    pystr_strip(t);
+    n = t->length;
+    pystr_free(t);
+    return n;
 }
 
-int main() {
+// find, count, split, replace and strip on mb megabytes of text
+void run_ops_bench(size_t mb) {
+    static const char *words[] = {"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "and", "runs", "away", "again"};
+    size_t len = mb << 20;
+    unsigned long long rng = 88172645463325252ull;
+    trace = 0;
+    pystr *s = pystr_new();
+    pystr_reserve(s, len + 16);
+    while (s->length < len) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        pystr_append(s, words[rng % 12]);
+        pystr_append(s, (rng >> 20 & 15) ? " " : (rng >> 24 & 1) ? ", " : "\n");
+    }
+    printf("pystr operations on %zu MB of text (%s)\n", mb,
+#ifdef __SSE2__
+           __builtin_cpu_supports("avx2") ? "AVX2" : "SSE2");
+#else
+           "no SIMD");
+#endif
+    printf("%-34s %10s %10s %9s\n", "operation", "bytes s", "SIMD s", "speedup");
+    time_op("find a byte (absent)", op_find_byte, s);
+    time_op("find a substring (absent)", op_find_sub, s);
+    time_op("count '\\n'", op_count, s);
+    time_op("count \"fox\"", op_count_sub, s);
+    time_op("split on '\\n' (views)", op_split_char, s);
+    time_op("split on \", \" (views)", op_split_sub, s);
+    time_op("replace \"fox\" with \"cat\"", op_replace, s);
+    double t0 = now_sec();
+    const char *m = memchr(s->data, '#', s->length);
+    printf("%-34s %10s %10.4f   (glibc, %s)\n", "memchr() for reference", "", now_sec() - t0, m ? "found" : "absent");
+
+    // A short string in MB of whitespace on each side
+    pystr *padded = pystr_new();
+    pystr_reserve(padded, len + 64);
+    for (size_t i = 0; i < len / 2; ++i) padded->data[i] = " \t\n "[i & 3];
+    padded->length = len / 2;
+    pystr_append(padded, "text in the middle");
+    for (size_t i = 0; i < len / 2; ++i) padded->data[padded->length + i] = "  \r\n"[i & 3];
+    padded->length += len / 2;
+    padded->data[padded->length] = '\0';
+    time_op("strip (copy included)", op_strip, padded);
+    pystr_free(padded);
+    pystr_free(s);
+    use_simd = 1;
+}
+
+// Insert and delete in a flat buffer: everything after pos moves
+static void flat_insert(pystr *s, size_t pos, const char *p, size_t n) {
+    pystr_reserve(s, s->length + n);
+    memmove(s->data + pos + n, s->data + pos, s->length - pos + 1);
+    memcpy(s->data + pos, p, n);
+    s->length += n;
+}
+
+static void flat_delete(pystr *s, size_t pos, size_t n) {
+    memmove(s->data + pos, s->data + pos + n, s->length - pos - n + 1);
+    s->length -= n;
+}
+
+// Edits in the middle of mb megabytes, as a flat pystr and as a rope
+void run_rope_bench(size_t mb, size_t edits) {
+    size_t len = mb << 20;
+    unsigned long long rng = 88172645463325252ull;
+    char *text = (char *)malloc(len);
+    FILE *devnull = fopen("/dev/null", "w");
+    if (text == NULL || devnull == NULL) {
+        fprintf(stderr, "[Error] out of memory\n");
+        return;
+    }
+    trace = 0;
+    for (size_t i = 0; i < len; ++i) text[i] = "abcdefghijklmnopqrstuvwxyz \n"[(i * 2654435761u >> 7) % 28];
+    printf("Rope benchmark: %zu MB, %zu edits (an insert of 16 bytes or a delete of 16)\n", mb, edits);
+    printf("%-40s %12s %12s\n", "operation", "pystr s", "rope s");
+
+    double t0 = now_sec();
+    pystr *s = pystr_new();
+    pystr_append_n(s, text, len);
+    double t_flat = now_sec() - t0;
+    t0 = now_sec();
+    RNode *r = rope_from(text, len);
+    printf("%-40s %12.3f %12.3f\n", "build from the text", t_flat, now_sec() - t0);
+
+    // The same random edit positions for both, all away from the ends
+    size_t *pos = (size_t *)malloc(edits * sizeof(size_t));
+    for (size_t i = 0; i < edits; ++i) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        pos[i] = len / 4 + rng % (len / 2);
+    }
+    t0 = now_sec();
+    for (size_t i = 0; i < edits; ++i) {
+        if (i & 1) flat_delete(s, pos[i], 16);
+        else flat_insert(s, pos[i], "<inserted text!>", 16);
+    }
+    t_flat = now_sec() - t0;
+    t0 = now_sec();
+    for (size_t i = 0; i < edits; ++i) {
+        if (i & 1) r = rope_delete(r, pos[i], 16);
+        else r = rope_insert(r, pos[i], "<inserted text!>", 16);
+    }
+    double t_rope = now_sec() - t0;
+    printf("%-40s %12.3f %12.3f\n", "edits", t_flat, t_rope);
+    printf("%-40s %12.1f %12.2f\n", "microseconds per edit", t_flat * 1e6 / edits, t_rope * 1e6 / edits);
+
+    t0 = now_sec();
+    size_t sum = 0;
+    for (size_t i = 0; i < 1000000; ++i) sum += (unsigned char)s->data[pos[i % edits] + i % 7];
+    t_flat = now_sec() - t0;
+    t0 = now_sec();
+    for (size_t i = 0; i < 1000000; ++i) sum -= (unsigned char)rope_index(r, pos[i % edits] + i % 7);
+    printf("%-40s %12.3f %12.3f\n", "1M reads of single bytes", t_flat, now_sec() - t0);
+
+    t0 = now_sec();
+    fwrite(s->data, 1, s->length, devnull);
+    t_flat = now_sec() - t0;
+    t0 = now_sec();
+    rope_write(r, devnull);
+    printf("%-40s %12.3f %12.3f\n", "write out (rope: iterator, no copy)", t_flat, now_sec() - t0);
+
+    t0 = now_sec();
+    pystr *flat = rope_flatten(r);
+    printf("%-40s %12s %12.3f\n", "flatten the rope into a pystr", "", now_sec() - t0);
+    int same = flat->length == s->length && memcmp(flat->data, s->data, s->length) == 0 && sum == 0;
+    printf("rope %s the edited pystr (%zu bytes)\n", same ? "matches" : "DIFFERS FROM", s->length);
+
+    // Joining two halves: a copy of the second half, or O(log n)
+    RNode *a, *b;
+    rope_split(r, len / 2, &a, &b);
+    t0 = now_sec();
+    pystr_append_n(flat, s->data, s->length);
+    t_flat = now_sec() - t0;
+    t0 = now_sec();
+    r = rope_concat(b, a);
+    printf("%-40s %12.3f %12.6f\n", "concatenate another copy / the halves", t_flat, now_sec() - t0);
+
+    pystr_free(flat);
+    pystr_free(s);
+    rope_free(r);
+    free(pos);
+    free(text);
+    fclose(devnull);
+}
+
+// Sharing, slicing and dict lookups: istr against copies and rehashing
+void run_istr_bench(size_t n) {
+    size_t nkeys = 100000;
+    char buf[64];
+    istr **keys = (istr **)malloc(nkeys * sizeof(istr *));      // interned
+    istr **copies = (istr **)malloc(nkeys * sizeof(istr *));    // equal text, separate objects
+    trace = 0;
+    for (size_t i = 0; i < nkeys; ++i) {
+        int len = snprintf(buf, sizeof buf, "customer-%09zu-region-eu-west-1", i * 7919 % 1000003);
+        keys[i] = istr_intern(istr_new(buf, len));
+        copies[i] = istr_new(buf, len);
+    }
+    printf("istr benchmark: %zu operations, %zu keys of %zu bytes\n", n, nkeys, keys[0]->length);
+    printf("%-44s %10s\n", "operation", "seconds");
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) istr_decref(istr_new(keys[i % nkeys]->data, keys[i % nkeys]->length));
+    printf("%-44s %10.3f\n", "keep a string: defensive copy", now_sec() - t0);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) istr_decref(istr_incref(keys[i % nkeys]));
+    printf("%-44s %10.3f\n", "keep a string: reference", now_sec() - t0);
+
+    size_t textlen = 1 << 20;
+    char *raw = (char *)malloc(textlen);
+    for (size_t i = 0; i < textlen; ++i) raw[i] = 'a' + i % 26;
+    istr *text = istr_new(raw, textlen);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) {
+        size_t start = i * 4099 % (textlen - 4096);
+        istr_decref(istr_new(text->data + start, 4096));
+    }
+    printf("%-44s %10.3f\n", "4 KB slices: copied", now_sec() - t0);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) {
+        size_t start = i * 4099 % (textlen - 4096);
+        istr_decref(istr_slice(text, start, start + 4096));
+    }
+    printf("%-44s %10.3f\n", "4 KB slices: views", now_sec() - t0);
+
+    idict *d = idict_new();
+    for (size_t i = 0; i < nkeys; ++i) idict_put(d, keys[i], (void *)(i + 1));
+    size_t found = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) {
+        istr *k = copies[i * 31 % nkeys];
+        atomic_store(&k->hash, 0);           // as with plain char * keys: hash every time
+        found += idict_get(d, k) != NULL;
+    }
+    printf("%-44s %10.3f\n", "dict lookups: hash + compare bytes", now_sec() - t0);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) found += idict_get(d, copies[i * 31 % nkeys]) != NULL;
+    printf("%-44s %10.3f\n", "dict lookups: cached hash + compare bytes", now_sec() - t0);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; ++i) found += idict_get(d, keys[i * 31 % nkeys]) != NULL;
+    printf("%-44s %10.3f\n", "dict lookups: interned, pointer compare", now_sec() - t0);
+    printf("%zu of %zu lookups found their key\n", found, 3 * n);
+
+    idict_free(d);
+    for (size_t i = 0; i < nkeys; ++i) {
+        istr_decref(keys[i]);
+        istr_decref(copies[i]);
+    }
+    istr_decref(text);
+    istr_intern_clear();
+    free(keys);
+    free(copies);
+    free(raw);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-rope") == 0) {
+        size_t mb = argc > 2 ? strtoul(argv[2], NULL, 10) : 100;
+        size_t edits = argc > 3 ? strtoul(argv[3], NULL, 10) : 2000;
+        if (mb == 0 || edits == 0) {
+            fprintf(stderr, "[Error] --bench-rope needs a positive size in MB and number of edits\n");
+            return EXIT_FAILURE;
+        }
+        run_rope_bench(mb, edits);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-ops") == 0) {
+        run_ops_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 64);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-istr") == 0) {
+        run_istr_bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000);
+        return 0;
+    }
     pystr *s = pystr_new();
     pystr_dump(s);
     pystr_append(s, "Hello");
@@ -106,13 +1610,81 @@ int main() {
     pystr_append(s, " This is a long string to test buffer expansion.");
     pystr_dump(s);
     pystr_free(s);
+
+    const char *text = "slices need no terminator";
+    s = pystr_new();
+    pystr_append_n(s, text, 6);
+    pystr_appendf(s, " %d, %s %.1f%%", 42, "and", 99.5);
+    pystr_dump(s);
+    pystr_free(s);
+
+    const char *parts[] = {"red", "green", "blue"};
+    s = pystr_join(", ", parts, 3);
+    pystr_dump(s);
+    pystr_free(s);
+
+    s = pystr_new();
+    pystr_append(s, "  \tapples, pears, apples, plums\n ");
+    pystr_strip(s);
+    printf("find('pears') = %ld, count('apples') = %zu\n", pystr_find(s, "pears", 5), pystr_count(s, "apples", 6));
+    size_t nparts;
+    pyview *v = pystr_split(s, ", ", 2, &nparts);
+    for (size_t i = 0; i < nparts; ++i) printf("  part %zu: '%.*s' at %p\n", i, (int)v[i].length, v[i].data, (void*)v[i].data);
+    free(v);
+    pystr *r2 = pystr_replace(s, "apples", 6, "figs", 4);
+    pystr_dump(r2);
+    pystr_free(r2);
+    pystr_free(s);
+
+    const char *p;
+    size_t n;
+    struct rope_iter it;
+    RNode *r = rope_concat(rope_from("Hello, ", 7), rope_from("world!", 6));
+    r = rope_insert(r, 7, "big ", 4);
+    r = rope_delete(r, 0, 7);
+    printf("[rope] %zu bytes in pieces:", rope_length(r));
+    rope_iter_init(&it, r);
+    while (rope_iter_next(&it, &p, &n)) printf(" '%.*s'", (int)n, p);
+    printf("\n");
+    s = rope_flatten(r);
+    pystr_dump(s);
+    pystr_free(s);
+    rope_free(r);
+
+    istr *hello = istr_new("Hello, world!", 13);
+    istr *view = istr_slice(hello, 7, 12);
+    istr_decref(hello);                  // the slice keeps the bytes alive
+    printf("[istr] slice '%.*s' of length %zu, hash %zx\n", (int)view->length, view->data, view->length, istr_hash(view));
+    istr *a = istr_intern(view);
+    istr *b = istr_intern(istr_new("world", 5));
+    printf("[istr] interned: %p and %p are %s\n", (void*)a, (void*)b, a == b ? "the same object" : "different objects");
+    idict *d = idict_new();
+    idict_put(d, a, "planet");
+    istr *c = istr_new("world", 5);
+    printf("[idict] d['world'] = '%s' (by pointer), '%s' (by bytes)\n", (char *)idict_get(d, b), (char *)idict_get(d, c));
+    istr_decref(c);
+    idict_free(d);
+    istr_decref(a);
+    istr_decref(b);
+    istr_intern_clear();
     return 0;
 }
 
 /*
 Tutorial Notes:
 - This struct and functions mimic a subset of Python's str class in C.
-- The buffer grows in chunks of 10 bytes as needed (like Python's dynamic resizing).
+- The buffer at least doubles when it grows (CPython over-allocates its lists and
+  string builders the same way), so appends cost amortized O(1) per byte.
+- pystr_reserve() allocates once when the final length is known in advance.
+- Passing lengths along (append_n, join) avoids measuring the same bytes twice;
+  formatting in place (appendf) avoids a temporary buffer and a second copy.
+- Trace output behind a macro costs nothing when it is compiled out.
+- SIMD compares many bytes per instruction; a bit mask says where the matches are.
+- A rope trades O(1) indexing for O(log n) edits anywhere; immutable leaves can be
+  shared and cut without copying.
+- An immutable string can be shared by reference count and sliced without copying;
+  its hash can be cached, and interning turns equality into a pointer comparison.
+- Short strings are stored in the struct itself: one malloc() per string instead of two.
 - All memory is managed with malloc/realloc/free.
 - This is a foundation for more advanced string types in C.
 */
@@ -25,6 +25,12 @@
  *   - Operands and results are integers.
  *   - The calculator prints the result or an error message.
  *
+ * Modes:
+ *   ./rpn_calculator          int mode (the default, described above)
+ *   ./rpn_calculator --big    bignum mode: exact arbitrary-precision integers
+ *   ./rpn_calculator --batch  one expression per line until EOF, with a result cache
+ *   ./rpn_calculator --bench  times bignum multiplication and printing
+ *
  * The calculator uses a stack to evaluate the expression.
  */
 
@@ -32,25 +38,52 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
 
-#define MAX_STACK 100
 #define MAX_LINE 256
 
-// Stack implementation for integer values
+// Exits with an error message if memory runs out
+static void *xrealloc(void *p, size_t size) {
+    p = realloc(p, size);
+    if (!p) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+// Growable stack implementation for integer values
 typedef struct {
-    int data[MAX_STACK];
+    int *data;
     int top;
+    int cap;
 } Stack;
 
 // Initialize the stack
-void init(Stack *s) { s->top = -1; }
+void init(Stack *s) {
+    s->data = NULL;
+    s->top = -1;
+    s->cap = 0;
+}
+// Release the stack's storage
+void stack_free(Stack *s) {
+    free(s->data);
+    init(s);
+}
+// Make room for at least n values (the stack doubles, so pushes are amortized O(1))
+void reserve(Stack *s, int n) {
+    if (n <= s->cap) return;
+    int cap = s->cap ? s->cap : 16;
+    while (cap < n) cap *= 2;
+    s->data = (int *)xrealloc(s->data, cap * sizeof(int));
+    s->cap = cap;
+}
 // Returns 1 if the stack is empty, 0 otherwise
 int is_empty(Stack *s) { return s->top == -1; }
-// Returns 1 if the stack is full, 0 otherwise
-int is_full(Stack *s) { return s->top == MAX_STACK - 1; }
-// Pushes a value onto the stack. Returns 1 on success, 0 if full.
+// Pushes a value onto the stack, growing it if needed. Always succeeds.
 int push(Stack *s, int val) {
-    if (is_full(s)) return 0;
+    reserve(s, s->top + 2);
     s->data[++(s->top)] = val;
     return 1;
 }
@@ -61,7 +94,1446 @@ int pop(Stack *s, int *val) {
     return 1;
 }
 
-int main() {
+/*
+ * ---------------------------------------------------------------------------
+ * Words and threaded code
+ * ---------------------------------------------------------------------------
+ *
+ * Like Forth, the calculator lets you name an operator sequence:
+ *
+ *   : sq dup * ;  3 sq  4 sq +        =>  Result: 25
+ *
+ * ": name" starts a definition and ";" ends it. Besides + - * / there are
+ * four stack words:
+ *   dup   a -- a a        swap  a b -- b a
+ *   drop  a --            over  a b -- a b a
+ *
+ * A line is not interpreted token by token. It is first compiled into a
+ * code array of cells (opcode + literal), then run by a small threaded
+ * interpreter that jumps straight from one cell's handler to the next.
+ * Defined words are compiled once, when they are defined, and calls are
+ * inlined: using "sq" copies its cells into the caller's code. At run time
+ * there are no dictionary lookups, no string compares and no call/return.
+ * Since each level of nesting can double the size, a word or line that
+ * would compile to more than MAX_CODE_CELLS cells is rejected.
+ *
+ * There is no branching, so every stack effect is known at compile time.
+ * The compiler uses that to report "Not enough operands" and a wrong
+ * final stack depth before anything runs, and to size the stack once,
+ * so the interpreter's push/pop need no checks.
+ *
+ * A word name always refers to the definitions made before it, so a
+ * redefinition does not change words already compiled from the old one.
+ * Definitions stay for the rest of the run (across lines in --batch mode).
+ */
+
+#define MAX_CODE_CELLS (1 << 20)  // longest compiled word or line (24 MB)
+
+enum {
+    OP_LIT, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_FACT,
+    OP_DUP, OP_SWAP, OP_DROP, OP_OVER, OP_END
+};
+
+typedef struct {
+    int op;
+    int value;          // OP_LIT: the number as an int
+    const char *text;   // OP_LIT: the number as written (for bignum mode)
+} Cell;
+
+typedef struct {
+    Cell *cells;
+    int n, cap;
+    int depth;          // stack depth after the code, relative to entry
+    int need;           // values that must be on the stack on entry
+    int peak;           // highest depth reached, relative to entry
+} Code;
+
+typedef struct {
+    char *name;
+    Code code;
+    char **lits;        // literal texts owned by this word
+    int nlits;
+} Word;
+
+static Word *dict;
+static int dict_n, dict_cap;
+
+static const struct {
+    const char *name;
+    int op, need, effect;
+} builtins[] = {
+    {"+", OP_ADD, 2, -1}, {"-", OP_SUB, 2, -1}, {"*", OP_MUL, 2, -1}, {"/", OP_DIV, 2, -1},
+    {"^", OP_POW, 2, -1}, {"!", OP_FACT, 1, 0},
+    {"dup", OP_DUP, 1, 1}, {"swap", OP_SWAP, 2, 0}, {"drop", OP_DROP, 1, -1}, {"over", OP_OVER, 2, 1},
+};
+
+static void code_init(Code *c) {
+    memset(c, 0, sizeof(*c));
+}
+
+static void code_free(Code *c) {
+    free(c->cells);
+    code_init(c);
+}
+
+static void code_emit(Code *c, Cell cell) {
+    if (c->n == c->cap) {
+        c->cap = c->cap ? c->cap * 2 : 32;
+        c->cells = (Cell *)xrealloc(c->cells, c->cap * sizeof(Cell));
+    }
+    c->cells[c->n++] = cell;
+}
+
+// Records a stack effect: needs `need` values on the stack, leaves depth + effect,
+// and rises to at most depth + rise on the way
+static void code_effect(Code *c, int need, int effect, int rise) {
+    if (need - c->depth > c->need) c->need = need - c->depth;
+    if (c->depth + rise > c->peak) c->peak = c->depth + rise;
+    c->depth += effect;
+}
+
+static int is_number(const char *t) {
+    return isdigit((unsigned char)t[0]) || (t[0] == '-' && isdigit((unsigned char)t[1]));
+}
+
+// Newest definition of name, or NULL
+static Word *find_word(const char *name) {
+    for (int i = dict_n - 1; i >= 0; --i)
+        if (strcmp(dict[i].name, name) == 0) return &dict[i];
+    return NULL;
+}
+
+// Compiles one token into c. Returns 1 on success, 0 (after printing an error) on failure.
+// With strict set (top-level code) the stack may never underflow.
+static int compile_token(Code *c, const char *token, int strict, int allow_big, Word *owner) {
+    if (is_number(token)) {
+        Cell cell = {OP_LIT, atoi(token), token};
+        if (owner) {
+            owner->lits = (char **)xrealloc(owner->lits, (owner->nlits + 1) * sizeof(char *));
+            cell.text = owner->lits[owner->nlits++] = strdup(token);
+        }
+        code_emit(c, cell);
+        code_effect(c, 0, 1, 1);
+        return 1;
+    }
+
+    int need, effect, rise;
+    Word *w = find_word(token);
+    const Code *body = w ? &w->code : NULL;
+    int op = -1;
+    if (w) {
+        need = body->need;
+        effect = body->depth;
+        rise = body->peak;
+    } else {
+        for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i) {
+            if (strcmp(builtins[i].name, token) == 0 && (allow_big || builtins[i].op < OP_POW || builtins[i].op > OP_FACT)) {
+                op = builtins[i].op;
+                need = builtins[i].need;
+                effect = builtins[i].effect;
+                rise = effect > 0 ? effect : 0;
+                break;
+            }
+        }
+        if (op < 0) {
+            printf("Error: Invalid token '%s'\n", token);
+            return 0;
+        }
+    }
+    if (strict && c->depth < need) {
+        printf("Error: Not enough operands for '%s'\n", token);
+        return 0;
+    }
+    if ((w ? body->n : 1) > MAX_CODE_CELLS - c->n) {
+        printf("Error: Code too long: '%s' would exceed %d cells\n", token, MAX_CODE_CELLS);
+        return 0;
+    }
+    if (w) {
+        for (int i = 0; i < body->n; ++i) code_emit(c, body->cells[i]);   // inline the body
+    } else {
+        code_emit(c, (Cell){op, 0, NULL});
+    }
+    code_effect(c, need, effect, rise);
+    return 1;
+}
+
+// Compiles a whole line (definitions and code) into c, terminated by OP_END.
+// strtok() is used on line, and literal cells point into it.
+// Returns 1 on success, 0 (after printing an error) on failure.
+static int compile_line(Code *c, char *line, int allow_big) {
+    code_init(c);
+    for (char *token = strtok(line, " \t\n"); token; token = strtok(NULL, " \t\n")) {
+        if (strcmp(token, ":") != 0) {
+            if (!compile_token(c, token, 1, allow_big, NULL)) return 0;
+            continue;
+        }
+        // ": name body ;"
+        char *name = strtok(NULL, " \t\n");
+        if (!name || is_number(name) || strcmp(name, ";") == 0 || strcmp(name, ":") == 0) {
+            printf("Error: ':' must be followed by a word name\n");
+            return 0;
+        }
+        Word w = {strdup(name), {0}, NULL, 0};
+        int ok = 0;
+        for (token = strtok(NULL, " \t\n"); token; token = strtok(NULL, " \t\n")) {
+            if (strcmp(token, ";") == 0) { ok = 1; break; }
+            if (strcmp(token, ":") == 0) {
+                printf("Error: Definitions cannot be nested (in '%s')\n", name);
+                break;
+            }
+            if (!compile_token(&w.code, token, 0, allow_big, &w)) break;
+        }
+        if (!ok) {
+            if (!token) printf("Error: Definition of '%s' is missing ';'\n", name);
+            free(w.name);
+            code_free(&w.code);
+            for (int i = 0; i < w.nlits; ++i) free(w.lits[i]);
+            free(w.lits);
+            return 0;
+        }
+        if (dict_n == dict_cap) {
+            dict_cap = dict_cap ? dict_cap * 2 : 16;
+            dict = (Word *)xrealloc(dict, dict_cap * sizeof(Word));
+        }
+        dict[dict_n++] = w;
+    }
+    code_emit(c, (Cell){OP_END, 0, NULL});
+    return 1;
+}
+
+// Frees every defined word
+static void dict_free(void) {
+    for (int i = 0; i < dict_n; ++i) {
+        free(dict[i].name);
+        code_free(&dict[i].code);
+        for (int j = 0; j < dict[i].nlits; ++j) free(dict[i].lits[j]);
+        free(dict[i].lits);
+    }
+    free(dict);
+    dict = NULL;
+    dict_n = dict_cap = 0;
+}
+
+// Runs compiled int code on s. Returns 1 on success, 0 on a run-time error.
+//
+// Each handler ends by jumping directly to the handler of the next cell
+// (a GCC/Clang "computed goto"), instead of going back through one shared
+// switch at the top of a loop.
+static int run_code(const Code *c, Stack *s) {
+    static const void *handlers[] = {
+        [OP_LIT] = &&op_lit, [OP_ADD] = &&op_add, [OP_SUB] = &&op_sub,
+        [OP_MUL] = &&op_mul, [OP_DIV] = &&op_div, [OP_POW] = &&op_bad,
+        [OP_FACT] = &&op_bad, [OP_DUP] = &&op_dup, [OP_SWAP] = &&op_swap,
+        [OP_DROP] = &&op_drop, [OP_OVER] = &&op_over, [OP_END] = &&op_end,
+    };
+    reserve(s, s->top + 1 + c->peak);
+    int *sp = s->data + s->top;     // top of stack
+    const Cell *ip = c->cells;
+    int t;
+
+#define NEXT goto *handlers[(ip++)->op]
+    NEXT;
+op_lit:  *++sp = ip[-1].value; NEXT;
+op_add:  sp[-1] += sp[0]; sp--; NEXT;
+op_sub:  sp[-1] -= sp[0]; sp--; NEXT;
+op_mul:  sp[-1] *= sp[0]; sp--; NEXT;
+op_div:
+    if (sp[0] == 0) {
+        printf("Error: Division by zero\n");
+        return 0;
+    }
+    sp[-1] /= sp[0]; sp--; NEXT;
+op_dup:  sp[1] = sp[0]; sp++; NEXT;
+op_swap: t = sp[0]; sp[0] = sp[-1]; sp[-1] = t; NEXT;
+op_drop: sp--; NEXT;
+op_over: sp[1] = sp[-1]; sp++; NEXT;
+op_bad:
+    printf("Error: Operator only available in bignum mode\n");
+    return 0;
+op_end:
+    s->top = (int)(sp - s->data);
+    return 1;
+#undef NEXT
+}
+
+// A complete expression leaves exactly one value. Returns 1 if c does, else prints an error.
+static int check_result_depth(const Code *c) {
+    if (c->depth == 1) return 1;
+    printf("Error: Stack has %d items after evaluation (should be 1)\n", c->depth);
+    return 0;
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Bignum mode (./rpn_calculator --big)
+ * ---------------------------------------------------------------------------
+ *
+ * In int mode "a * b" silently overflows once the result passes 2^31.
+ * Bignum mode keeps every value as an arbitrary-precision integer:
+ *
+ *   - A Big is a sign plus a vector of 32-bit "limbs" (base 2^32 digits),
+ *     least significant limb first.
+ *   - Limb buffers come from a pool of power-of-two size classes. A freed
+ *     buffer goes back onto its class's free list, so a long chain of
+ *     operations reuses the same few buffers instead of calling malloc
+ *     for every intermediate result.
+ *   - Multiplication is schoolbook (O(n^2)) below KARATSUBA_THRESHOLD limbs
+ *     and Karatsuba (O(n^1.585)) above it.
+ *   - Division is Knuth's Algorithm D (long division, one limb per step).
+ *   - Decimal output splits the number by 10^(9*2^k) recursively
+ *     (divide and conquer), so most of the work is done on small,
+ *     cache-friendly pieces instead of dividing the whole number by 10^9
+ *     over and over.
+ *
+ * Extra operators in bignum mode:
+ *   a b ^   a to the power b (b must be a non-negative machine integer)
+ *   a !     factorial of a (a must be a non-negative machine integer)
+ *
+ * Example:
+ *   Input:  2 100 ^ 1 -
+ *   Output: Result: 1267650600228229401496703205375
+ */
+
+typedef uint32_t limb_t;
+typedef uint64_t dlimb_t;
+
+#define LIMB_BITS 32
+#define KARATSUBA_THRESHOLD 32   // limbs; below this schoolbook is faster
+#define DEC_BASE_LIMBS 32        // limbs; below this decimal output is done naively
+#define POOL_CLASSES 48
+
+typedef struct {
+    int sign;      // -1, 0 or +1
+    size_t n;      // limbs in use (no leading zero limbs; 0 means the value 0)
+    size_t cap;    // limbs allocated (a pool size class)
+    limb_t *d;     // little-endian limbs
+} Big;
+
+/* ---------- Limb buffer pool ---------- */
+
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+} PoolBlock;
+
+static PoolBlock *limb_pool[POOL_CLASSES];  // one free list per power-of-two size
+static size_t pool_hits, pool_misses;
+
+// Smallest class c with 2^c >= n limbs (minimum 4 limbs so a free block can hold a pointer)
+static int size_class(size_t n) {
+    int c = 2;
+    while (((size_t)1 << c) < n) c++;
+    return c;
+}
+
+// Takes a buffer of at least n limbs from the pool (or malloc if the class is empty)
+static limb_t *limbs_get(size_t n, size_t *cap) {
+    int c = size_class(n);
+    PoolBlock *b = limb_pool[c];
+    if (b) {
+        limb_pool[c] = b->next;
+        pool_hits++;
+    } else {
+        b = (PoolBlock *)malloc(((size_t)1 << c) * sizeof(limb_t));
+        if (!b) {
+            fprintf(stderr, "Error: out of memory allocating %zu limbs\n", n);
+            exit(1);
+        }
+        pool_misses++;
+    }
+    if (cap) *cap = (size_t)1 << c;
+    return (limb_t *)b;
+}
+
+// Returns a buffer obtained from limbs_get() to its free list
+static void limbs_put(limb_t *p, size_t cap) {
+    if (!p) return;
+    PoolBlock *b = (PoolBlock *)p;
+    int c = size_class(cap);
+    b->next = limb_pool[c];
+    limb_pool[c] = b;
+}
+
+// Releases every pooled buffer back to the C heap
+static void pool_drain(void) {
+    for (int c = 0; c < POOL_CLASSES; ++c) {
+        while (limb_pool[c]) {
+            PoolBlock *next = limb_pool[c]->next;
+            free(limb_pool[c]);
+            limb_pool[c] = next;
+        }
+    }
+}
+
+/* ---------- Magnitude helpers (raw limb arrays, no sign) ---------- */
+
+// Length of a without leading zero limbs
+static size_t mag_norm(const limb_t *a, size_t an) {
+    while (an > 0 && a[an - 1] == 0) an--;
+    return an;
+}
+
+// Compares two normalized magnitudes: -1, 0 or +1
+static int mag_cmp(const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    if (an != bn) return an < bn ? -1 : 1;
+    while (an-- > 0)
+        if (a[an] != b[an]) return a[an] < b[an] ? -1 : 1;
+    return 0;
+}
+
+// r[0..rn) += a[0..an), an <= rn. Returns the carry out of r[rn-1].
+static limb_t mag_add_to(limb_t *r, size_t rn, const limb_t *a, size_t an) {
+    dlimb_t carry = 0;
+    size_t i = 0;
+    for (; i < an; ++i) {
+        carry += (dlimb_t)r[i] + a[i];
+        r[i] = (limb_t)carry;
+        carry >>= LIMB_BITS;
+    }
+    for (; carry && i < rn; ++i) {
+        carry += r[i];
+        r[i] = (limb_t)carry;
+        carry >>= LIMB_BITS;
+    }
+    return (limb_t)carry;
+}
+
+// r[0..rn) -= a[0..an), an <= rn. Returns the borrow out of r[rn-1].
+static limb_t mag_sub_from(limb_t *r, size_t rn, const limb_t *a, size_t an) {
+    limb_t borrow = 0;
+    size_t i = 0;
+    for (; i < an; ++i) {
+        dlimb_t t = (dlimb_t)r[i] - a[i] - borrow;
+        r[i] = (limb_t)t;
+        borrow = (limb_t)(t >> 63);
+    }
+    for (; borrow && i < rn; ++i) {
+        borrow = r[i] == 0;
+        r[i]--;
+    }
+    return borrow;
+}
+
+// r[0..an+bn) = a * b, the O(n^2) way we learned at school
+static void mag_mul_school(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    memset(r, 0, (an + bn) * sizeof(limb_t));
+    for (size_t i = 0; i < bn; ++i) {
+        dlimb_t carry = 0, bi = b[i];
+        if (bi == 0) continue;
+        for (size_t j = 0; j < an; ++j) {
+            carry += a[j] * bi + r[i + j];
+            r[i + j] = (limb_t)carry;
+            carry >>= LIMB_BITS;
+        }
+        r[i + an] = (limb_t)carry;
+    }
+}
+
+// r[0..an+bn) = a * b. r must not overlap a or b.
+//
+// Karatsuba splits a = a1*B^m + a0 and b = b1*B^m + b0 and uses
+//   a*b = z2*B^2m + (z1 - z2 - z0)*B^m + z0
+// with z0 = a0*b0, z2 = a1*b1, z1 = (a0+a1)*(b0+b1): three half-size
+// products instead of four.
+static void mag_mul(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    if (an < bn) {
+        const limb_t *t = a; a = b; b = t;
+        size_t tn = an; an = bn; bn = tn;
+    }
+    if (bn < KARATSUBA_THRESHOLD) {
+        mag_mul_school(r, a, an, b, bn);
+        return;
+    }
+    if (an >= 2 * bn) {
+        // Very unbalanced: multiply b by bn-sized slices of a and add them up
+        size_t tcap;
+        limb_t *t = limbs_get(2 * bn, &tcap);
+        memset(r, 0, (an + bn) * sizeof(limb_t));
+        for (size_t i = 0; i < an; i += bn) {
+            size_t len = an - i < bn ? an - i : bn;
+            mag_mul(t, a + i, len, b, bn);
+            mag_add_to(r + i, an + bn - i, t, len + bn);
+        }
+        limbs_put(t, tcap);
+        return;
+    }
+
+    size_t m = an / 2;                 // bn > m because an < 2*bn
+    size_t a1n = an - m, b1n = bn - m;
+    size_t san = a1n + 1, sbn = (m > b1n ? m : b1n) + 1;
+    size_t sacap, sbcap, zcap;
+    limb_t *sa = limbs_get(san, &sacap);
+    limb_t *sb = limbs_get(sbn, &sbcap);
+    limb_t *z1 = limbs_get(san + sbn, &zcap);
+
+    // sa = a0 + a1, sb = b0 + b1
+    memcpy(sa, a + m, a1n * sizeof(limb_t));
+    sa[a1n] = 0;
+    mag_add_to(sa, san, a, m);
+    memset(sb, 0, sbn * sizeof(limb_t));
+    memcpy(sb, b, m * sizeof(limb_t));
+    mag_add_to(sb, sbn, b + m, b1n);
+
+    mag_mul(r, a, m, b, m);                        // z0 -> r[0..2m)
+    mag_mul(r + 2 * m, a + m, a1n, b + m, b1n);    // z2 -> r[2m..an+bn)
+    mag_mul(z1, sa, san, sb, sbn);                 // z1
+    size_t z1n = san + sbn;
+    mag_sub_from(z1, z1n, r, 2 * m);
+    mag_sub_from(z1, z1n, r + 2 * m, an + bn - 2 * m);
+    z1n = mag_norm(z1, z1n);
+    mag_add_to(r + m, an + bn - m, z1, z1n);
+
+    limbs_put(sa, sacap);
+    limbs_put(sb, sbcap);
+    limbs_put(z1, zcap);
+}
+
+// Number of leading zero bits in a non-zero limb
+static int limb_clz(limb_t x) {
+    int n = 0;
+    while (!(x & 0x80000000u)) { x <<= 1; n++; }
+    return n;
+}
+
+// Long division (Knuth's Algorithm D, as written in Hacker's Delight).
+// q[0..an-bn+1) = u / v and r[0..bn) = u % v, with an >= bn >= 1 and v[bn-1] != 0.
+// Either q or r may be NULL.
+static void mag_divmod(limb_t *q, limb_t *r, const limb_t *u, size_t an, const limb_t *v, size_t bn) {
+    const dlimb_t B = (dlimb_t)1 << LIMB_BITS;
+    if (bn == 1) {
+        dlimb_t k = 0;
+        for (size_t j = an; j-- > 0;) {
+            dlimb_t cur = (k << LIMB_BITS) | u[j];
+            if (q) q[j] = (limb_t)(cur / v[0]);
+            k = cur % v[0];
+        }
+        if (r) r[0] = (limb_t)k;
+        return;
+    }
+
+    // Normalize so the top bit of the divisor is set; this keeps qhat within 2 of the truth
+    int s = limb_clz(v[bn - 1]);
+    size_t vcap, ucap;
+    limb_t *vn = limbs_get(bn, &vcap);
+    limb_t *un = limbs_get(an + 1, &ucap);
+    for (size_t i = bn - 1; i > 0; --i)
+        vn[i] = (v[i] << s) | (limb_t)((dlimb_t)v[i - 1] >> (LIMB_BITS - s));
+    vn[0] = v[0] << s;
+    un[an] = (limb_t)((dlimb_t)u[an - 1] >> (LIMB_BITS - s));
+    for (size_t i = an - 1; i > 0; --i)
+        un[i] = (u[i] << s) | (limb_t)((dlimb_t)u[i - 1] >> (LIMB_BITS - s));
+    un[0] = u[0] << s;
+
+    for (size_t j = an - bn + 1; j-- > 0;) {
+        dlimb_t num = ((dlimb_t)un[j + bn] << LIMB_BITS) | un[j + bn - 1];
+        dlimb_t qhat = num / vn[bn - 1];
+        dlimb_t rhat = num % vn[bn - 1];
+        while (qhat >= B || qhat * vn[bn - 2] > ((rhat << LIMB_BITS) | un[j + bn - 2])) {
+            qhat--;
+            rhat += vn[bn - 1];
+            if (rhat >= B) break;
+        }
+
+        // Multiply and subtract qhat * vn from un[j..j+bn]
+        int64_t t, k = 0;
+        for (size_t i = 0; i < bn; ++i) {
+            dlimb_t p = qhat * vn[i];
+            t = (int64_t)un[i + j] - k - (int64_t)(p & 0xFFFFFFFFu);
+            un[i + j] = (limb_t)t;
+            k = (int64_t)(p >> LIMB_BITS) - (t >> LIMB_BITS);
+        }
+        t = (int64_t)un[j + bn] - k;
+        un[j + bn] = (limb_t)t;
+
+        // qhat was one too large: add the divisor back
+        if (t < 0) {
+            qhat--;
+            dlimb_t c = 0;
+            for (size_t i = 0; i < bn; ++i) {
+                c += (dlimb_t)un[i + j] + vn[i];
+                un[i + j] = (limb_t)c;
+                c >>= LIMB_BITS;
+            }
+            un[j + bn] += (limb_t)c;
+        }
+        if (q) q[j] = (limb_t)qhat;
+    }
+
+    if (r) {
+        for (size_t i = 0; i < bn - 1; ++i)
+            r[i] = (un[i] >> s) | (limb_t)((dlimb_t)un[i + 1] << (LIMB_BITS - s));
+        r[bn - 1] = un[bn - 1] >> s;
+    }
+    limbs_put(vn, vcap);
+    limbs_put(un, ucap);
+}
+
+/* ---------- Big values ---------- */
+
+static void big_init(Big *x) {
+    x->sign = 0;
+    x->n = x->cap = 0;
+    x->d = NULL;
+}
+
+static void big_free(Big *x) {
+    limbs_put(x->d, x->cap);
+    big_init(x);
+}
+
+// Makes sure x can hold n limbs; keeps the current value
+static void big_reserve(Big *x, size_t n) {
+    if (x->cap >= n) return;
+    size_t cap;
+    limb_t *d = limbs_get(n, &cap);
+    if (x->n) memcpy(d, x->d, x->n * sizeof(limb_t));
+    limbs_put(x->d, x->cap);
+    x->d = d;
+    x->cap = cap;
+}
+
+// Trims leading zero limbs and fixes the sign of zero
+static void big_fix(Big *x) {
+    x->n = mag_norm(x->d, x->n);
+    if (x->n == 0) x->sign = 0;
+}
+
+static void big_set_u64(Big *x, uint64_t v) {
+    big_reserve(x, 2);
+    x->d[0] = (limb_t)v;
+    x->d[1] = (limb_t)(v >> LIMB_BITS);
+    x->n = 2;
+    x->sign = 1;
+    big_fix(x);
+}
+
+static void big_copy(Big *dst, const Big *src) {
+    big_reserve(dst, src->n);
+    if (src->n) memcpy(dst->d, src->d, src->n * sizeof(limb_t));
+    dst->n = src->n;
+    dst->sign = src->sign;
+}
+
+// Moves src into dst without copying limbs; src becomes 0
+static void big_move(Big *dst, Big *src) {
+    big_free(dst);
+    *dst = *src;
+    big_init(src);
+}
+
+// x = x * m + a, for small m and a (used when parsing decimal input)
+static void big_mul_add_small(Big *x, limb_t m, limb_t a) {
+    big_reserve(x, x->n + 1);
+    dlimb_t carry = a;
+    for (size_t i = 0; i < x->n; ++i) {
+        carry += (dlimb_t)x->d[i] * m;
+        x->d[i] = (limb_t)carry;
+        carry >>= LIMB_BITS;
+    }
+    x->d[x->n++] = (limb_t)carry;
+    if (x->sign == 0) x->sign = 1;
+    big_fix(x);
+}
+
+// Parses an optionally negative decimal string. Returns 1 on success, 0 on bad input.
+static int big_from_str(Big *x, const char *s) {
+    int neg = 0;
+    if (*s == '-') { neg = 1; s++; }
+    if (!isdigit((unsigned char)*s)) return 0;
+    x->n = 0;
+    x->sign = 0;
+    // Consume 9 digits at a time: x = x * 10^9 + chunk
+    size_t len = strlen(s);
+    size_t first = len % 9 ? len % 9 : 9;
+    while (*s) {
+        limb_t chunk = 0, scale = 1;
+        for (size_t i = 0; i < first; ++i, ++s) {
+            if (!isdigit((unsigned char)*s)) return 0;
+            chunk = chunk * 10 + (limb_t)(*s - '0');
+            scale *= 10;
+        }
+        big_mul_add_small(x, scale, chunk);
+        first = 9;
+    }
+    if (x->n && neg) x->sign = -1;
+    return 1;
+}
+
+// r = a + b (sign-aware). r may alias a or b.
+static void big_add_signed(Big *r, const Big *a, const Big *b, int bsign) {
+    if (b->n == 0) { if (r != a) big_copy(r, a); return; }
+    if (a->n == 0) { if (r != b) big_copy(r, b); r->sign = bsign; return; }
+    Big t;
+    big_init(&t);
+    if (a->sign == bsign) {
+        const Big *big = a->n >= b->n ? a : b, *small = a->n >= b->n ? b : a;
+        big_reserve(&t, big->n + 1);
+        memcpy(t.d, big->d, big->n * sizeof(limb_t));
+        t.d[big->n] = 0;
+        t.n = big->n + 1;
+        mag_add_to(t.d, t.n, small->d, small->n);
+        t.sign = a->sign;
+    } else {
+        int c = mag_cmp(a->d, a->n, b->d, b->n);
+        const Big *big = c >= 0 ? a : b, *small = c >= 0 ? b : a;
+        big_reserve(&t, big->n);
+        memcpy(t.d, big->d, big->n * sizeof(limb_t));
+        t.n = big->n;
+        mag_sub_from(t.d, t.n, small->d, small->n);
+        t.sign = c >= 0 ? a->sign : bsign;
+    }
+    big_fix(&t);
+    big_move(r, &t);
+}
+
+static void big_add(Big *r, const Big *a, const Big *b) { big_add_signed(r, a, b, b->sign); }
+static void big_sub(Big *r, const Big *a, const Big *b) { big_add_signed(r, a, b, -b->sign); }
+
+// r = a * b. r may alias a or b.
+static void big_mul(Big *r, const Big *a, const Big *b) {
+    Big t;
+    big_init(&t);
+    if (a->n && b->n) {
+        big_reserve(&t, a->n + b->n);
+        mag_mul(t.d, a->d, a->n, b->d, b->n);
+        t.n = a->n + b->n;
+        t.sign = a->sign * b->sign;
+        big_fix(&t);
+    }
+    big_move(r, &t);
+}
+
+// q = a / b and r = a % b, truncating toward zero like C. b must be non-zero.
+// Either q or r may be NULL; neither may alias a or b.
+static void big_divmod(Big *q, Big *r, const Big *a, const Big *b) {
+    if (mag_cmp(a->d, a->n, b->d, b->n) < 0) {
+        if (r) big_copy(r, a);
+        if (q) { big_free(q); }
+        return;
+    }
+    if (q) {
+        big_reserve(q, a->n - b->n + 1);
+        q->n = a->n - b->n + 1;
+    }
+    if (r) {
+        big_reserve(r, b->n);
+        r->n = b->n;
+    }
+    mag_divmod(q ? q->d : NULL, r ? r->d : NULL, a->d, a->n, b->d, b->n);
+    if (q) { q->sign = a->sign * b->sign; big_fix(q); }
+    if (r) { r->sign = a->sign; big_fix(r); }
+}
+
+// r = a^e by square-and-multiply
+static void big_pow(Big *r, const Big *a, uint32_t e) {
+    Big base, acc;
+    big_init(&base);
+    big_init(&acc);
+    big_copy(&base, a);
+    big_set_u64(&acc, 1);
+    while (e) {
+        if (e & 1) big_mul(&acc, &acc, &base);
+        e >>= 1;
+        if (e) big_mul(&base, &base, &base);
+    }
+    big_free(&base);
+    big_move(r, &acc);
+}
+
+// r = lo * (lo+1) * ... * hi, split in halves so the big multiplies are balanced
+static void big_range_product(Big *r, uint64_t lo, uint64_t hi) {
+    if (hi - lo < 8) {
+        big_set_u64(r, lo);
+        for (uint64_t i = lo + 1; i <= hi; ++i)
+            big_mul_add_small(r, (limb_t)i, 0);
+        return;
+    }
+    uint64_t mid = lo + (hi - lo) / 2;
+    Big right;
+    big_init(&right);
+    big_range_product(r, lo, mid);
+    big_range_product(&right, mid + 1, hi);
+    big_mul(r, r, &right);
+    big_free(&right);
+}
+
+// r = n!
+static void big_factorial(Big *r, uint32_t n) {
+    if (n < 2) big_set_u64(r, 1);
+    else big_range_product(r, 2, n);
+}
+
+// Converts a small non-negative Big to uint32. Returns 0 if it does not fit.
+static int big_to_u32(const Big *x, uint32_t *out) {
+    if (x->sign < 0 || x->n > 1) return 0;
+    *out = x->n ? x->d[0] : 0;
+    return 1;
+}
+
+/* ---------- Decimal output ---------- */
+
+#define MAX_POW10 40
+static Big pow10_cache[MAX_POW10];   // pow10_cache[k] = 10^(9 * 2^k)
+static int pow10_count;
+
+// Returns 10^(9 * 2^k), computing and caching squares as needed
+static const Big *pow10_level(int k) {
+    while (pow10_count <= k) {
+        if (pow10_count == 0) big_set_u64(&pow10_cache[0], 1000000000u);
+        else big_mul(&pow10_cache[pow10_count], &pow10_cache[pow10_count - 1], &pow10_cache[pow10_count - 1]);
+        pow10_count++;
+    }
+    return &pow10_cache[k];
+}
+
+static void pow10_drain(void) {
+    for (int k = 0; k < pow10_count; ++k) big_free(&pow10_cache[k]);
+    pow10_count = 0;
+}
+
+// Writes exactly width digits of magnitude x (zero-padded on the left) by repeated
+// division by 10^9. This is the O(n^2) base case; x is clobbered.
+static void dec_naive(limb_t *x, size_t xn, char *out, size_t width) {
+    char *p = out + width;
+    while (p > out) {
+        xn = mag_norm(x, xn);
+        limb_t rem = 0;
+        if (xn) mag_divmod(x, &rem, x, xn, (const limb_t[]){1000000000u}, 1);
+        for (int i = 0; i < 9 && p > out; ++i) {
+            *--p = (char)('0' + rem % 10);
+            rem /= 10;
+        }
+    }
+}
+
+// Writes exactly 9 * 2^(k+1) digits of magnitude x, where x < 10^(9 * 2^(k+1)).
+// Splits x = hi * 10^(9*2^k) + lo and recurses on both halves.
+static void dec_rec(const Big *x, int k, char *out) {
+    size_t width = (size_t)9 << (k + 1);
+    if (k == 0 || x->n <= DEC_BASE_LIMBS) {
+        size_t cap;
+        limb_t *t = limbs_get(x->n + 1, &cap);
+        if (x->n) memcpy(t, x->d, x->n * sizeof(limb_t));
+        dec_naive(t, x->n, out, width);
+        limbs_put(t, cap);
+        return;
+    }
+    Big hi, lo;
+    big_init(&hi);
+    big_init(&lo);
+    big_divmod(&hi, &lo, x, pow10_level(k));
+    dec_rec(&hi, k - 1, out);
+    dec_rec(&lo, k - 1, out + width / 2);
+    big_free(&hi);
+    big_free(&lo);
+}
+
+// Returns a malloc'd decimal string for x; the caller frees it
+static char *big_to_str(const Big *x) {
+    // Smallest k with |x| < 10^(9 * 2^(k+1)), i.e. x fits in two level-k halves
+    int k = 0;
+    while (mag_cmp(x->d, x->n, pow10_level(k + 1)->d, pow10_level(k + 1)->n) >= 0) k++;
+    size_t width = (size_t)9 << (k + 1);
+    char *buf = (char *)malloc(width + 2);
+    if (!buf) {
+        fprintf(stderr, "Error: out of memory formatting result\n");
+        exit(1);
+    }
+    dec_rec(x, k, buf + 1);
+    buf[width + 1] = '\0';
+    // Strip the zero padding, keep at least one digit, then put the sign in front
+    char *p = buf + 1;
+    while (*p == '0' && p[1]) p++;
+    if (x->sign < 0) *--p = '-';
+    memmove(buf, p, strlen(p) + 1);
+    return buf;
+}
+
+// Compiles one RPN line and runs it with Big values, then prints the result.
+// Returns 0 on success, 1 on error.
+static int eval_big(char *line) {
+    Code code;
+    if (!compile_line(&code, line, 1) || !check_result_depth(&code)) {
+        code_free(&code);
+        return 1;
+    }
+
+    Big *stack = (Big *)xrealloc(NULL, code.peak * sizeof(Big));
+    int top = -1, status = 1;
+    Big a, b, q;
+    big_init(&a);
+    big_init(&b);
+    big_init(&q);
+
+    for (const Cell *ip = code.cells; ip->op != OP_END; ++ip) {
+        Big *r;
+        uint32_t n;
+        switch (ip->op) {
+            case OP_LIT:
+                big_init(&stack[++top]);
+                if (!big_from_str(&stack[top], ip->text)) {
+                    printf("Error: Invalid number '%s'\n", ip->text);
+                    goto done;
+                }
+                break;
+            case OP_DUP:
+                big_init(&stack[top + 1]);
+                big_copy(&stack[top + 1], &stack[top]);
+                top++;
+                break;
+            case OP_SWAP: {
+                Big t = stack[top];
+                stack[top] = stack[top - 1];
+                stack[top - 1] = t;
+                break;
+            }
+            case OP_DROP:
+                big_free(&stack[top--]);
+                break;
+            case OP_OVER:
+                big_init(&stack[top + 1]);
+                big_copy(&stack[top + 1], &stack[top - 1]);
+                top++;
+                break;
+            case OP_FACT:
+                if (!big_to_u32(&stack[top], &n)) {
+                    printf("Error: Factorial needs a non-negative machine-size integer\n");
+                    goto done;
+                }
+                big_factorial(&stack[top], n);
+                break;
+            default:
+                big_move(&b, &stack[top--]);
+                big_move(&a, &stack[top]);
+                r = &stack[top];
+                switch (ip->op) {
+                    case OP_ADD: big_add(r, &a, &b); break;
+                    case OP_SUB: big_sub(r, &a, &b); break;
+                    case OP_MUL: big_mul(r, &a, &b); break;
+                    case OP_DIV:
+                        if (b.n == 0) {
+                            printf("Error: Division by zero\n");
+                            goto done;
+                        }
+                        big_divmod(&q, NULL, &a, &b);
+                        big_move(r, &q);
+                        break;
+                    case OP_POW:
+                        if (!big_to_u32(&b, &n)) {
+                            printf("Error: Exponent must be a non-negative machine-size integer\n");
+                            goto done;
+                        }
+                        big_pow(r, &a, n);
+                        break;
+                }
+        }
+    }
+    char *s = big_to_str(&stack[0]);
+    printf("Result: %s\n", s);
+    free(s);
+    status = 0;
+
+done:
+    while (top >= 0) big_free(&stack[top--]);
+    free(stack);
+    big_free(&a);
+    big_free(&b);
+    big_free(&q);
+    code_free(&code);
+    return status;
+}
+
+// Interactive bignum mode: one expression, exact result
+static int run_big(void) {
+    char *line = NULL;
+    size_t linecap = 0;
+    printf("Reverse Polish Notation (RPN) Calculator - bignum mode\n");
+    printf("------------------------------------------------------\n");
+    printf("Enter a space-separated RPN expression.\n");
+    printf("  Example: 2 100 ^ 1 -\n");
+    printf("  Example: 1000 ! 998 ! /\n");
+    printf("Supported operators: +  -  *  /  ^  !\n");
+    printf("Stack words: dup  swap  drop  over   Define a word: : name ... ;\n");
+    printf("Operands and results are arbitrary-precision integers.\n");
+    printf("> ");
+    if (getline(&line, &linecap, stdin) < 0) {
+        free(line);
+        return 1;
+    }
+    int status = eval_big(line);
+    free(line);
+    dict_free();
+    pow10_drain();
+    pool_drain();
+    return status;
+}
+
+/* ---------- Benchmarks (./rpn_calculator --bench) ---------- */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// x = a random positive number with about the given number of decimal digits
+static void big_random(Big *x, size_t digits) {
+    size_t n = (size_t)(digits * 3.321928094887362 / LIMB_BITS) + 1;
+    big_reserve(x, n);
+    for (size_t i = 0; i < n; ++i)
+        x->d[i] = ((limb_t)rand() << 16) ^ (limb_t)rand();
+    x->d[n - 1] |= 1;
+    x->n = n;
+    x->sign = 1;
+}
+
+// Times schoolbook vs Karatsuba multiplication and naive vs divide-and-conquer printing
+static void run_bench(void) {
+    const size_t sizes[] = {10000, 20000, 50000, 100000};
+    printf("RPN bignum benchmark (times in milliseconds)\n");
+    printf("%8s %6s %12s %12s %12s %12s\n", "digits", "limbs", "mul-school", "mul-karat", "print-naive", "print-d&c");
+    srand(12345);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        Big a, b, p;
+        big_init(&a);
+        big_init(&b);
+        big_init(&p);
+        big_random(&a, sizes[s]);
+        big_random(&b, sizes[s]);
+        size_t n = a.n;
+
+        size_t rcap;
+        limb_t *r = limbs_get(2 * n, &rcap);
+        double t0 = now_sec();
+        mag_mul_school(r, a.d, n, b.d, n);
+        double t_school = now_sec() - t0;
+
+        t0 = now_sec();
+        big_mul(&p, &a, &b);
+        double t_kara = now_sec() - t0;
+        if (mag_cmp(r, mag_norm(r, 2 * n), p.d, p.n) != 0)
+            printf("[bench] MISMATCH: schoolbook and Karatsuba disagree at %zu digits\n", sizes[s]);
+
+        size_t width = n * 10 + 9;
+        char *naive = (char *)malloc(width + 1);
+        memcpy(r, a.d, n * sizeof(limb_t));
+        t0 = now_sec();
+        dec_naive(r, n, naive, width);
+        double t_naive = now_sec() - t0;
+        naive[width] = '\0';
+
+        t0 = now_sec();
+        char *dc = big_to_str(&a);
+        double t_dc = now_sec() - t0;
+        const char *np = naive;
+        while (*np == '0' && np[1]) np++;
+        if (strcmp(np, dc) != 0)
+            printf("[bench] MISMATCH: naive and divide-and-conquer output disagree at %zu digits\n", sizes[s]);
+
+        printf("%8zu %6zu %12.2f %12.2f %12.2f %12.2f\n", sizes[s], n,
+               t_school * 1e3, t_kara * 1e3, t_naive * 1e3, t_dc * 1e3);
+        free(naive);
+        free(dc);
+        limbs_put(r, rcap);
+        big_free(&a);
+        big_free(&b);
+        big_free(&p);
+    }
+    printf("Limb pool: %zu buffers reused, %zu fresh allocations\n", pool_hits, pool_misses);
+    pow10_drain();
+    pool_drain();
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * Batch mode with a result cache (./rpn_calculator --batch [CACHE_SIZE])
+ * ---------------------------------------------------------------------------
+ *
+ * Batch mode reads one int-mode expression per line until end of input and
+ * prints one result per line. Batch inputs repeat a lot, so instead of
+ * running the stack machine on every line we:
+ *
+ *   1. Build an operator DAG for the line. Each number and operator becomes
+ *      a node; the stack holds node numbers instead of values.
+ *   2. Canonicalize: + and * are commutative, so their two children are
+ *      put in a fixed order ("3 4 +" and "4 3 +" become the same node).
+ *   3. Hash-cons: every node gets a structure hash computed from its
+ *      operator and its children's hashes. A node whose (op, left, right)
+ *      already exists in this line is reused, so a repeated sub-expression
+ *      within a line is one shared node and is evaluated once.
+ *   4. Memoize: results of operator nodes are kept in a bounded LRU cache
+ *      keyed by structure hash. The cache lives for the whole batch, so a
+ *      sub-expression seen on an earlier line is looked up, not recomputed.
+ *      Evaluation is top-down, so a whole repeated line costs one lookup.
+ *
+ * The structure hash is 64 bits; cache entries also record the operator and
+ * both child hashes, so a false hit needs a 64-bit collision on each side.
+ * Errors (division by zero) are never cached.
+ *
+ * At the end, cache statistics are printed to stderr.
+ *
+ * Example:
+ *   printf '3 4 + 2 *\n2 4 3 + *\n' | ./rpn_calculator --batch
+ *   14
+ *   14        (second line canonicalizes to the same DAG as the first,
+ *              so the whole expression is one cache hit)
+ */
+
+#define DEFAULT_CACHE_SIZE 65536
+
+typedef struct {
+    int op;             // OP_LIT or an arithmetic operator
+    int value;          // OP_LIT: the number; otherwise the result once known
+    int known;          // 1 once value is valid for an operator node; 2 while its children are evaluated
+    int left, right;    // child node numbers (operators only)
+    uint64_t hash;      // structure hash
+} DagNode;
+
+typedef struct {
+    DagNode *nodes;     // nodes of the current line, children before parents
+    int count, cap;
+    uint32_t *slot_node;   // hash-cons table: node number per slot...
+    uint32_t *slot_gen;    // ...valid only if slot_gen matches gen
+    uint32_t slots, gen;
+    long shared;           // nodes found already present (hash-cons hits)
+    long built;            // nodes created
+    int *work;             // dag_eval()'s stack of node numbers
+    int workcap;
+} Dag;
+
+typedef struct {
+    uint64_t hash, lhash, rhash;
+    int op, value;
+    int prev, next;     // LRU list (most recent at head)
+    int chain;          // next entry in the same bucket
+} CacheEntry;
+
+typedef struct {
+    CacheEntry *entries;
+    int *buckets;       // bucket -> first entry, -1 if empty
+    int cap, used, nbuckets;
+    int head, tail;
+    long lookups, hits, misses, evictions;
+} LruCache;
+
+// 64-bit finalizer from SplitMix64: spreads every input bit over the output
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t dag_hash(int op, int value, uint64_t lhash, uint64_t rhash) {
+    if (op == OP_LIT) return mix64((uint64_t)(uint32_t)value ^ 0x9E3779B97F4A7C15ull);
+    return mix64(mix64(lhash ^ (uint64_t)op) + rhash * 0x9E3779B97F4A7C15ull);
+}
+
+static void dag_init(Dag *g) {
+    memset(g, 0, sizeof(*g));
+}
+
+static void dag_free(Dag *g) {
+    free(g->nodes);
+    free(g->slot_node);
+    free(g->slot_gen);
+    free(g->work);
+}
+
+// Starts a new line: forget all nodes without clearing the hash-cons table
+static void dag_reset(Dag *g) {
+    g->count = 0;
+    if (++g->gen == 0) {        // generation counter wrapped: really clear once
+        memset(g->slot_gen, 0, g->slots * sizeof(uint32_t));
+        g->gen = 1;
+    }
+}
+
+// Inserts node number i into the hash-cons table (which must have a free slot)
+static void dag_slot_insert(Dag *g, int i) {
+    uint32_t mask = g->slots - 1;
+    uint32_t s = (uint32_t)g->nodes[i].hash & mask;
+    while (g->slot_gen[s] == g->gen) s = (s + 1) & mask;
+    g->slot_gen[s] = g->gen;
+    g->slot_node[s] = (uint32_t)i;
+}
+
+// Keeps the hash-cons table at most half full
+static void dag_grow_slots(Dag *g) {
+    if ((uint32_t)g->count * 2 < g->slots) return;
+    uint32_t n = g->slots ? g->slots * 2 : 256;
+    free(g->slot_node);
+    free(g->slot_gen);
+    g->slot_node = (uint32_t *)xrealloc(NULL, n * sizeof(uint32_t));
+    g->slot_gen = (uint32_t *)calloc(n, sizeof(uint32_t));
+    if (!g->slot_gen) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    g->slots = n;
+    g->gen = 1;
+    for (int i = 0; i < g->count; ++i) dag_slot_insert(g, i);
+}
+
+// Returns the node for (op, value | left, right), creating it only if the line doesn't have it yet
+static int dag_node(Dag *g, int op, int value, int left, int right) {
+    uint64_t lh = 0, rh = 0;
+    if (op != OP_LIT) {
+        lh = g->nodes[left].hash;
+        rh = g->nodes[right].hash;
+        if ((op == OP_ADD || op == OP_MUL) && lh > rh) {
+            int t = left; left = right; right = t;
+            uint64_t th = lh; lh = rh; rh = th;
+        }
+    }
+    uint64_t h = dag_hash(op, value, lh, rh);
+
+    dag_grow_slots(g);
+    uint32_t mask = g->slots - 1;
+    for (uint32_t s = (uint32_t)h & mask; g->slot_gen[s] == g->gen; s = (s + 1) & mask) {
+        DagNode *n = &g->nodes[g->slot_node[s]];
+        if (n->hash == h && n->op == op &&
+            (op == OP_LIT ? n->value == value : (n->left == left && n->right == right))) {
+            g->shared++;
+            return (int)g->slot_node[s];
+        }
+    }
+
+    if (g->count == g->cap) {
+        g->cap = g->cap ? g->cap * 2 : 64;
+        g->nodes = (DagNode *)xrealloc(g->nodes, g->cap * sizeof(DagNode));
+    }
+    int i = g->count++;
+    DagNode *n = &g->nodes[i];
+    n->op = op;
+    n->value = value;
+    n->known = (op == OP_LIT);
+    n->left = left;
+    n->right = right;
+    n->hash = h;
+    dag_slot_insert(g, i);
+    g->built++;
+    return i;
+}
+
+static void cache_init(LruCache *c, int cap) {
+    memset(c, 0, sizeof(*c));
+    c->cap = cap;
+    c->nbuckets = 1;
+    while (c->nbuckets < cap) c->nbuckets *= 2;
+    c->entries = (CacheEntry *)xrealloc(NULL, (size_t)cap * sizeof(CacheEntry));
+    c->buckets = (int *)xrealloc(NULL, (size_t)c->nbuckets * sizeof(int));
+    for (int i = 0; i < c->nbuckets; ++i) c->buckets[i] = -1;
+    c->head = c->tail = -1;
+}
+
+static void cache_free(LruCache *c) {
+    free(c->entries);
+    free(c->buckets);
+}
+
+static void lru_unlink(LruCache *c, int i) {
+    CacheEntry *e = &c->entries[i];
+    if (e->prev >= 0) c->entries[e->prev].next = e->next; else c->head = e->next;
+    if (e->next >= 0) c->entries[e->next].prev = e->prev; else c->tail = e->prev;
+}
+
+static void lru_push_front(LruCache *c, int i) {
+    CacheEntry *e = &c->entries[i];
+    e->prev = -1;
+    e->next = c->head;
+    if (c->head >= 0) c->entries[c->head].prev = i;
+    c->head = i;
+    if (c->tail < 0) c->tail = i;
+}
+
+// Looks up an operator node's result. Returns 1 and sets *value on a hit.
+static int cache_get(LruCache *c, const Dag *g, const DagNode *n, int *value) {
+    uint64_t lh = g->nodes[n->left].hash, rh = g->nodes[n->right].hash;
+    c->lookups++;
+    for (int i = c->buckets[n->hash & (uint64_t)(c->nbuckets - 1)]; i >= 0; i = c->entries[i].chain) {
+        CacheEntry *e = &c->entries[i];
+        if (e->hash == n->hash && e->op == n->op && e->lhash == lh && e->rhash == rh) {
+            lru_unlink(c, i);
+            lru_push_front(c, i);
+            c->hits++;
+            *value = e->value;
+            return 1;
+        }
+    }
+    c->misses++;
+    return 0;
+}
+
+// Stores an operator node's result, evicting the least recently used entry when full
+static void cache_put(LruCache *c, const Dag *g, const DagNode *n) {
+    int i;
+    if (c->used < c->cap) {
+        i = c->used++;
+    } else {
+        i = c->tail;
+        lru_unlink(c, i);
+        int *link = &c->buckets[c->entries[i].hash & (uint64_t)(c->nbuckets - 1)];
+        while (*link != i) link = &c->entries[*link].chain;
+        *link = c->entries[i].chain;
+        c->evictions++;
+    }
+    CacheEntry *e = &c->entries[i];
+    e->hash = n->hash;
+    e->lhash = g->nodes[n->left].hash;
+    e->rhash = g->nodes[n->right].hash;
+    e->op = n->op;
+    e->value = n->value;
+    int b = (int)(n->hash & (uint64_t)(c->nbuckets - 1));
+    e->chain = c->buckets[b];
+    c->buckets[b] = i;
+    lru_push_front(c, i);
+}
+
+// Computes operator node n from its children's values. Returns 1 on success, 0 on error.
+static int dag_apply(Dag *g, DagNode *n) {
+    int a = g->nodes[n->left].value, b = g->nodes[n->right].value;
+    switch (n->op) {
+        case OP_ADD: n->value = a + b; break;
+        case OP_SUB: n->value = a - b; break;
+        case OP_MUL: n->value = a * b; break;
+        case OP_DIV:
+            if (b == 0) {
+                printf("Error: Division by zero\n");
+                return 0;
+            }
+            n->value = a / b;
+            break;
+    }
+    return 1;
+}
+
+// Evaluates node i top-down: cache first, then children. Returns 1 on success, 0 on error.
+// An explicit stack instead of recursion, so a line nested 300k operators deep can't
+// overflow the C stack. Every node is expanded at most once and pushes at most two
+// children, so 2 * count + 1 entries are enough.
+static int dag_eval(Dag *g, LruCache *c, int i) {
+    if (g->workcap < 2 * g->count + 1) {
+        int *w = (int *)realloc(g->work, (2 * (size_t)g->count + 1) * sizeof(int));
+        if (!w) {
+            printf("Error: Out of memory\n");
+            return 0;
+        }
+        g->work = w;
+        g->workcap = 2 * g->count + 1;
+    }
+    int *sp = g->work;
+    *sp = i;
+    while (sp >= g->work) {
+        DagNode *n = &g->nodes[*sp];
+        if (n->known == 1) {
+            sp--;
+        } else if (n->known == 2) {         // children done: compute this node
+            if (!dag_apply(g, n)) return 0;     // the line's nodes are dropped anyway
+            n->known = 1;
+            cache_put(c, g, n);
+            sp--;
+        } else if (cache_get(c, g, n, &n->value)) {
+            n->known = 1;
+            sp--;
+        } else {
+            n->known = 2;
+            *++sp = n->right;               // left is evaluated first
+            *++sp = n->left;
+        }
+    }
+    return 1;
+}
+
+// Compiles one line, builds its DAG and prints its value.
+// Returns 1 on success, 0 on error, -1 if the line only held definitions.
+static int batch_line(Dag *g, LruCache *c, char *line, Stack *stack) {
+    Code code;
+    int status = 0;
+    if (!compile_line(&code, line, 0)) goto done;
+    if (code.n == 1) {          // nothing but OP_END: the line only defined words
+        status = -1;
+        goto done;
+    }
+    if (!check_result_depth(&code)) goto done;
+
+    // Run the code symbolically: the stack holds node numbers, not values
+    dag_reset(g);
+    reserve(stack, code.peak);
+    int *sp = stack->data - 1, t;
+    for (const Cell *ip = code.cells; ip->op != OP_END; ++ip) {
+        switch (ip->op) {
+            case OP_LIT:  *++sp = dag_node(g, OP_LIT, ip->value, -1, -1); break;
+            case OP_DUP:  sp[1] = sp[0]; sp++; break;
+            case OP_SWAP: t = sp[0]; sp[0] = sp[-1]; sp[-1] = t; break;
+            case OP_DROP: sp--; break;
+            case OP_OVER: sp[1] = sp[-1]; sp++; break;
+            default:
+                sp[-1] = dag_node(g, ip->op, 0, sp[-1], sp[0]);
+                sp--;
+        }
+    }
+    if (!dag_eval(g, c, stack->data[0])) goto done;
+    printf("%d\n", g->nodes[stack->data[0]].value);
+    status = 1;
+
+done:
+    code_free(&code);
+    return status;
+}
+
+// Reads expressions until EOF, one result per line, then reports cache statistics
+static int run_batch(int cache_size) {
+    Dag g;
+    LruCache c;
+    char *line = NULL;
+    size_t linecap = 0;
+    Stack stack;
+    long lines = 0, errors = 0;
+
+    init(&stack);
+    dag_init(&g);
+    cache_init(&c, cache_size);
+    while (getline(&line, &linecap, stdin) >= 0) {
+        if (strspn(line, " \t\r\n") == strlen(line)) continue;   // skip blank lines
+        int status = batch_line(&g, &c, line, &stack);
+        if (status < 0) continue;                                 // definitions only
+        lines++;
+        if (status == 0) errors++;
+    }
+    fflush(stdout);
+
+    fprintf(stderr, "[cache] lines=%ld errors=%ld\n", lines, errors);
+    fprintf(stderr, "[cache] dag nodes built=%ld shared=%ld\n", g.built, g.shared);
+    fprintf(stderr, "[cache] lookups=%ld hits=%ld misses=%ld hit_rate=%.1f%%\n",
+            c.lookups, c.hits, c.misses, c.lookups ? 100.0 * c.hits / c.lookups : 0.0);
+    fprintf(stderr, "[cache] capacity=%d used=%d evictions=%ld\n", c.cap, c.used, c.evictions);
+
+    free(line);
+    stack_free(&stack);
+    dict_free();
+    dag_free(&g);
+    cache_free(&c);
+    return errors ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--big") == 0)
+        return run_big();
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        int cache_size = argc > 2 ? atoi(argv[2]) : DEFAULT_CACHE_SIZE;
+        if (cache_size < 1) {
+            fprintf(stderr, "Error: cache size must be a positive integer\n");
+            return 1;
+        }
+        return run_batch(cache_size);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench();
+        return 0;
+    }
+
     char line[MAX_LINE];
     Stack stack;
     init(&stack);
@@ -70,48 +1542,25 @@ int main() {
     printf("Enter a space-separated RPN expression.\n");
     printf("  Example: 3 4 + 2 *\n");
     printf("  Example: 15 7 1 1 + - / 3 * 2 1 1 + + -\n");
+    printf("  Example: : sq dup * ; 3 sq 4 sq +\n");
     printf("Supported operators: +  -  *  /\n");
+    printf("Stack words: dup  swap  drop  over   Define a word: : name ... ;\n");
     printf("Operands and results are integers.\n");
     printf("> ");
     if (!fgets(line, MAX_LINE, stdin)) return 1;
 
-    char *token = strtok(line, " \t\n");
-    while (token) {
-        if (isdigit(token[0]) || (token[0] == '-' && isdigit(token[1]))) {
-            push(&stack, atoi(token));
-        } else if (strlen(token) == 1 && strchr("+-*/", token[0])) {
-            int b, a;
-            if (!pop(&stack, &b) || !pop(&stack, &a)) {
-                printf("Error: Not enough operands for '%s'\n", token);
-                return 1;
-            }
-            int result;
-            switch (token[0]) {
-                case '+': result = a + b; break;
-                case '-': result = a - b; break;
-                case '*': result = a * b; break;
-                case '/':
-                    if (b == 0) {
-                        printf("Error: Division by zero\n");
-                        return 1;
-                    }
-                    result = a / b; break;
-                default:
-                    printf("Error: Unknown operator '%s'\n", token);
-                    return 1;
-            }
-            push(&stack, result);
-        } else {
-            printf("Error: Invalid token '%s'\n", token);
-            return 1;
-        }
-        token = strtok(NULL, " \t\n");
-    }
-    if (stack.top == 0) {
-        printf("Result: %d\n", stack.data[0]);
-    } else {
-        printf("Error: Stack has %d items after evaluation (should be 1)\n", stack.top + 1);
+    Code code;
+    if (!compile_line(&code, line, 0) || !check_result_depth(&code) || !run_code(&code, &stack)) {
+        code_free(&code);
+        stack_free(&stack);
+        dict_free();
         return 1;
     }
+    int result = 0;
+    pop(&stack, &result);
+    printf("Result: %d\n", result);
+    code_free(&code);
+    stack_free(&stack);
+    dict_free();
     return 0;
 }